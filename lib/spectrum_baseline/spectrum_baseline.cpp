@@ -0,0 +1,235 @@
+#include "spectrum_baseline.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+// NVS on the device; host builds (tools/host_replay) keep the model in RAM only
+#ifdef ARDUINO
+#include <Preferences.h>
+#endif
+
+#define NVS_NAMESPACE "baseline"
+#define NVS_INDEX_KEY "plans"
+#define BLOB_VERSION 1
+
+#define TRAIN_VISITS 4        // Visits before a bin's floor is trusted
+#define FAST_VISITS 16        // Plain averaging up to here, then a fixed gain
+#define LEARN_GAIN (1.0 / 32) // Weight of a new reading once converged
+#define CLIP_SPREADS 2.5      // Innovations are clipped to this many spreads
+#define INITIAL_SPREAD 2.0    // dB, before there is anything to measure
+#define MIN_SPREAD 0.5        // dB, keeps the clip from collapsing
+
+// NVS encoding: floor in 0.5 dB steps above -160 dBm (0 = untrained), spread in 0.1 dB
+#define FLOOR_BASE -160.0
+
+struct BlobHeader {
+  uint16_t version;
+  uint16_t bins;
+};
+
+static float floorDbm[BASELINE_MAX_BINS];
+static float spreadDb[BASELINE_MAX_BINS];
+static uint8_t visits[BASELINE_MAX_BINS];
+static int bins = 0;
+static uint32_t planKey = 0;
+static bool dirty = false;
+
+static uint8_t blob[sizeof(BlobHeader) + 2 * BASELINE_MAX_BINS];
+#ifdef ARDUINO
+static Preferences prefs;
+#endif
+
+// FNV-1a over the plan quantized to kHz and 0.1 kHz
+static uint32_t hashPlan(float beginMHz, float endMHz, int count, float rxBandwidthKHz) {
+  int32_t fields[4] = {
+    (int32_t)lround(beginMHz * 1000.0), (int32_t)lround(endMHz * 1000.0),
+    count, (int32_t)lround(rxBandwidthKHz * 10.0)
+  };
+  uint32_t hash = 2166136261UL;
+  const uint8_t* bytes = (const uint8_t*)fields;
+  for (size_t i = 0; i < sizeof(fields); i++) {
+    hash = (hash ^ bytes[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+static void planKeyName(uint32_t key, char name[12]) {
+  snprintf(name, 12, "p%08lx", (unsigned long)key);
+}
+
+#ifdef ARDUINO
+
+// Move `key` to the front of the MRU index; returns the plan that fell off, or 0
+static uint32_t touchIndex(uint32_t key) {
+  uint32_t index[BASELINE_MAX_PLANS] = {0};
+  prefs.getBytes(NVS_INDEX_KEY, index, sizeof(index));
+
+  uint32_t evicted = index[BASELINE_MAX_PLANS - 1];
+  int pos = BASELINE_MAX_PLANS - 1;
+  for (int i = 0; i < BASELINE_MAX_PLANS; i++) {
+    if (index[i] == key) {
+      pos = i;
+      evicted = 0;
+      break;
+    }
+  }
+  for (int i = pos; i > 0; i--) index[i] = index[i - 1];
+  index[0] = key;
+  prefs.putBytes(NVS_INDEX_KEY, index, sizeof(index));
+  return evicted;
+}
+
+static bool readBlob(const char* name, size_t expected) {
+  if (!prefs.begin(NVS_NAMESPACE, true)) return false;
+  bool ok = prefs.getBytesLength(name) == expected && prefs.getBytes(name, blob, expected) == expected;
+  prefs.end();
+  return ok;
+}
+
+static bool writeBlob(const char* name, size_t length) {
+  if (!prefs.begin(NVS_NAMESPACE, false)) return false;
+  bool ok = prefs.putBytes(name, blob, length) == length;
+  if (ok) {
+    uint32_t evicted = touchIndex(planKey);
+    if (evicted != 0) {
+      char old[12];
+      planKeyName(evicted, old);
+      prefs.remove(old);
+    }
+  }
+  prefs.end();
+  return ok;
+}
+
+static void removeBlob(const char* name) {
+  if (prefs.begin(NVS_NAMESPACE, false)) {
+    prefs.remove(name);
+    prefs.end();
+  }
+}
+#else
+static bool readBlob(const char*, size_t) { return false; }
+static bool writeBlob(const char*, size_t) { return false; }
+static void removeBlob(const char*) {}
+#endif
+
+static bool loadPlan() {
+  char name[12];
+  planKeyName(planKey, name);
+  size_t expected = sizeof(BlobHeader) + 2 * bins;
+  bool ok = readBlob(name, expected);
+
+  BlobHeader header;
+  memcpy(&header, blob, sizeof(header));
+  if (!ok || header.version != BLOB_VERSION || header.bins != bins) return false;
+
+  const uint8_t* floors = blob + sizeof(BlobHeader);
+  const uint8_t* spreads = floors + bins;
+  for (int i = 0; i < bins; i++) {
+    if (floors[i] == 0) continue;
+    floorDbm[i] = FLOOR_BASE + floors[i] / 2.0;
+    spreadDb[i] = std::max(spreads[i] / 10.0, MIN_SPREAD);
+    visits[i] = FAST_VISITS;
+  }
+  return true;
+}
+
+bool baselineSelect(float beginMHz, float endMHz, int count, float rxBandwidthKHz) {
+  baselineSave();
+
+  bins = std::min(count, BASELINE_MAX_BINS);
+  planKey = hashPlan(beginMHz, endMHz, bins, rxBandwidthKHz);
+  dirty = false;
+  for (int i = 0; i < bins; i++) {
+    floorDbm[i] = 0.0;
+    spreadDb[i] = INITIAL_SPREAD;
+    visits[i] = 0;
+  }
+  return loadPlan();
+}
+
+void baselineUpdate(int bin, float rssi) {
+  if (bin < 0 || bin >= bins) return;
+
+  if (visits[bin] == 0) {
+    floorDbm[bin] = rssi;
+    spreadDb[bin] = INITIAL_SPREAD;
+  } else {
+    float clip = CLIP_SPREADS * spreadDb[bin];
+    float error = std::min(std::max(rssi - floorDbm[bin], -clip), clip);
+    float gain = visits[bin] < FAST_VISITS ? 1.0 / (visits[bin] + 1) : LEARN_GAIN;
+    floorDbm[bin] += gain * error;
+    spreadDb[bin] += gain * (fabs(error) - spreadDb[bin]);
+    if (spreadDb[bin] < MIN_SPREAD) spreadDb[bin] = MIN_SPREAD;
+  }
+
+  if (visits[bin] < 255) visits[bin]++;
+  dirty = true;
+}
+
+bool baselineSave() {
+  if (!dirty || bins == 0) return false;
+
+  BlobHeader header = {BLOB_VERSION, (uint16_t)bins};
+  memcpy(blob, &header, sizeof(header));
+  uint8_t* floors = blob + sizeof(BlobHeader);
+  uint8_t* spreads = floors + bins;
+  for (int i = 0; i < bins; i++) {
+    if (visits[i] < TRAIN_VISITS) {
+      floors[i] = 0;
+      spreads[i] = 0;
+      continue;
+    }
+    floors[i] = std::min(std::max(lround((floorDbm[i] - FLOOR_BASE) * 2.0), 1L), 255L);
+    spreads[i] = std::min(std::max(lround(spreadDb[i] * 10.0), 0L), 255L);
+  }
+
+  char name[12];
+  planKeyName(planKey, name);
+  bool ok = writeBlob(name, sizeof(BlobHeader) + 2 * bins);
+  if (ok) dirty = false;
+  return ok;
+}
+
+void baselineClear() {
+  for (int i = 0; i < bins; i++) {
+    floorDbm[i] = 0.0;
+    spreadDb[i] = INITIAL_SPREAD;
+    visits[i] = 0;
+  }
+  dirty = false;
+
+  char name[12];
+  planKeyName(planKey, name);
+  removeBlob(name);
+}
+
+bool baselineTrained(int bin) {
+  return bin >= 0 && bin < bins && visits[bin] >= TRAIN_VISITS;
+}
+
+float baselineFloor(int bin) {
+  return floorDbm[bin];
+}
+
+float baselineSpread(int bin) {
+  return spreadDb[bin];
+}
+
+int baselineTrainedBins() {
+  int trained = 0;
+  for (int i = 0; i < bins; i++) {
+    if (visits[i] >= TRAIN_VISITS) trained++;
+  }
+  return trained;
+}
+
+bool baselineDirty() {
+  return dirty;
+}
+
+uint32_t baselinePlanKey() {
+  return planKey;
+}
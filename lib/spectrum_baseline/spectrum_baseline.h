@@ -0,0 +1,30 @@
+// Learned per-bin noise floor, persisted in NVS per sweep plan
+//
+// Each bin keeps a floor and a spread (mean absolute deviation). Updates are
+// clipped to a few spreads, so a transmitter only nudges the floor instead of
+// dragging it up. The model is saved under a key derived from the sweep plan
+// (span, bins, RX bandwidth) and restored when the same plan is selected again.
+
+#pragma once
+
+#include <stdint.h>
+
+#ifndef BASELINE_MAX_BINS
+#define BASELINE_MAX_BINS 1024
+#endif
+
+#define BASELINE_MAX_PLANS 3    // Plans kept in NVS, least recently used dropped
+
+// Saves the current model if it changed, then loads (or starts) the model
+// for the new plan. Returns true when a stored model was restored.
+bool baselineSelect(float beginMHz, float endMHz, int bins, float rxBandwidthKHz);
+void baselineUpdate(int bin, float rssi);
+bool baselineSave();    // Writes to NVS only if something changed
+void baselineClear();   // Forgets the current plan, in RAM and NVS
+
+bool baselineTrained(int bin);
+float baselineFloor(int bin);
+float baselineSpread(int bin);
+int baselineTrainedBins();
+bool baselineDirty();
+uint32_t baselinePlanKey();
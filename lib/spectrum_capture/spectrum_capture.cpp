@@ -0,0 +1,90 @@
+#include "spectrum_capture.h"
+
+static TriggerCondition condition = {0.0, 0.0, 0.0, 1};
+static int hitCount = 0;          // Consecutive sweeps with a hit so far
+static bool sweepHit = false;     // The running sweep already counted
+
+static int16_t buffer[CAPTURE_BUFFER_BINS];
+static uint32_t rowTimestamp[CAPTURE_MAX_ROWS];
+static uint32_t rowSeq[CAPTURE_MAX_ROWS];
+static uint32_t rowStart[CAPTURE_MAX_ROWS];
+static uint32_t rowDuration[CAPTURE_MAX_ROWS];
+static int bins = 0;
+static int rows = 0;
+static int head = 0;              // Next row to write
+static int stored = 0;
+
+void triggerSet(const TriggerCondition& newCondition) {
+  condition = newCondition;
+  if (condition.hits < 1) condition.hits = 1;
+  triggerRearm();
+}
+
+const TriggerCondition& triggerCondition() {
+  return condition;
+}
+
+bool triggerVisit(float mhz, float rssi) {
+  if (sweepHit || mhz < condition.beginMHz || mhz >= condition.endMHz) return false;
+  if (rssi <= condition.thresholdDbm) return false;
+
+  sweepHit = true;
+  if (++hitCount < condition.hits) return false;
+  triggerRearm();
+  return true;
+}
+
+void triggerSweepDone() {
+  if (!sweepHit) hitCount = 0;
+  sweepHit = false;
+}
+
+void triggerRearm() {
+  hitCount = 0;
+  sweepHit = false;
+}
+
+int triggerHitCount() {
+  return hitCount;
+}
+
+int captureRowsFor(int sweepBins) {
+  if (sweepBins <= 0) return 0;
+  return min(CAPTURE_MAX_ROWS, CAPTURE_BUFFER_BINS / sweepBins);
+}
+
+bool captureReset(int sweepBins, int sweepRows) {
+  if (sweepRows < 1 || sweepRows > captureRowsFor(sweepBins)) return false;
+  bins = sweepBins;
+  rows = sweepRows;
+  head = 0;
+  stored = 0;
+  return true;
+}
+
+void captureStore(const float* rssi, uint32_t timestamp, uint32_t seq, uint32_t start, uint32_t duration) {
+  if (rows == 0) return;
+  int16_t* row = buffer + head * bins;
+  for (int i = 0; i < bins; i++) {
+    row[i] = (int16_t)lroundf(constrain(rssi[i], -3000.0f, 3000.0f) * 10.0f);
+  }
+  rowTimestamp[head] = timestamp;
+  rowSeq[head] = seq;
+  rowStart[head] = start;
+  rowDuration[head] = duration;
+  head = (head + 1) % rows;
+  if (stored < rows) stored++;
+}
+
+int captureStored() {
+  return stored;
+}
+
+int captureRows() {
+  return rows;
+}
+
+CapturedSweep captureRow(int index) {
+  int row = (head - stored + index + rows) % rows;
+  return {rowTimestamp[row], rowSeq[row], rowStart[row], rowDuration[row], buffer + row * bins};
+}
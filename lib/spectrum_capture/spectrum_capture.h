@@ -0,0 +1,47 @@
+// Triggered capture: a condition checked as bins are written, and a ring of
+// recent sweeps so only the window around an event has to be sent
+//
+// The trigger fires when some bin inside [beginMHz, endMHz) reads above the
+// threshold on `hits` consecutive sweeps. triggerVisit() sees every reading,
+// so the capture starts on the bin that completes the condition, not at the
+// end of its sweep. Sweeps are kept as int16 rows in 0.1 dBm; how many fit
+// depends on the sweep resolution (CAPTURE_BUFFER_BINS readings in total).
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef CAPTURE_BUFFER_BINS
+#define CAPTURE_BUFFER_BINS 16384  // Readings stored across all rows (32 KB)
+#endif
+
+#define CAPTURE_MAX_ROWS 128       // Upper bound on stored sweeps
+
+struct TriggerCondition {
+  float beginMHz;
+  float endMHz;
+  float thresholdDbm;
+  int hits;             // Consecutive sweeps with a reading above the threshold
+};
+
+struct CapturedSweep {
+  uint32_t timestamp;   // millis() when the sweep was completed
+  uint32_t seq;         // Sweep sequence number
+  uint32_t start;       // millis() when the sweep started
+  uint32_t duration;    // ms
+  const int16_t* rssi;  // 0.1 dBm per bin
+};
+
+void triggerSet(const TriggerCondition& condition);
+const TriggerCondition& triggerCondition();
+bool triggerVisit(float mhz, float rssi);  // True on the reading that fires
+void triggerSweepDone();                   // A sweep without a hit resets the count
+void triggerRearm();
+int triggerHitCount();
+
+int captureRowsFor(int bins);              // Sweeps that fit at this resolution
+bool captureReset(int bins, int rows);     // Empty ring of `rows` sweeps
+void captureStore(const float* rssi, uint32_t timestamp, uint32_t seq, uint32_t start, uint32_t duration);
+int captureStored();
+int captureRows();
+CapturedSweep captureRow(int index);       // 0 is the oldest stored sweep
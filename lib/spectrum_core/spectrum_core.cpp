@@ -0,0 +1,113 @@
+#include "spectrum_core.h"
+
+namespace spectrum {
+
+float syntheticNoise(float mhz) {
+  float noiseBase = -120.0;                     // Base noise floor
+  float freqVariation = (mhz - 600.0) / 100.0;  // Some frequency-based variation
+  return noiseBase + freqVariation + random(-10, 5);  // -130 to -115 dBm range
+}
+
+int SpectrumRadio::begin(float mhz, float rxBandwidthKHz) {
+  // FSK mode gives direct access to the instantaneous RSSI
+  int state = radio.beginFSK(mhz);
+  if (state != RADIOLIB_ERR_NONE) return state;
+  calibratedBand = imageBand(mhz);  // beginFSK() calibrated for this range
+
+  state = setRxBandwidth(rxBandwidthKHz);
+  if (state != RADIOLIB_ERR_NONE) return state;
+  radio.setDataShaping(RADIOLIB_SHAPING_NONE);
+  return radio.startReceive();
+}
+
+int SpectrumRadio::setRxBandwidth(float rxBandwidthKHz) {
+  int state = radio.setRxBandwidth(rxBandwidthKHz);
+  if (state != RADIOLIB_ERR_NONE) return state;
+  // The RSSI register follows the channel filter, which settles in about one
+  // period of the RX bandwidth; reading faster only repeats the last value
+  sampleUs = max(BURST_MIN_GAP_US, (uint32_t)ceilf(1000.0f / rxBandwidthKHz));
+  return state;
+}
+
+int SpectrumRadio::tune(const BinTune& bin) {
+  if (source) {
+    sourceFreq = bin.freqMHz;
+    return RADIOLIB_ERR_NONE;
+  }
+
+  int state;
+  if (bin.band != calibratedBand) {
+    // New calibration range: let RadioLib run the image calibration
+    state = radio.setFrequency(bin.freqMHz);
+    if (state == RADIOLIB_ERR_NONE) calibratedBand = bin.band;
+  } else {
+    uint8_t data[4] = {
+      (uint8_t)(bin.word >> 24), (uint8_t)(bin.word >> 16), (uint8_t)(bin.word >> 8), (uint8_t)bin.word
+    };
+    state = radio.getMod()->SPIwriteStream(RADIOLIB_SX126X_CMD_SET_RF_FREQUENCY, data, 4);
+  }
+  if (state != RADIOLIB_ERR_NONE) return state;
+  return radio.startReceive();
+}
+
+int SpectrumRadio::readRSSIBlock(float* block, int samples, int settleMs, uint32_t* stamps) {
+  if (source) {
+    block[0] = source(sourceFreq);
+    if (stamps) stamps[0] = micros();
+    return 1;
+  }
+
+  delay(settleMs);
+  return burstRSSI(block, constrain(samples, 1, BURST_MAX_SAMPLES), stamps);
+}
+
+bool SpectrumRadio::readRSSI(float& rssi, int samples, int settleMs) {
+  float block[BURST_MAX_SAMPLES];
+  int valid = readRSSIBlock(block, samples, settleMs);
+  if (valid == 0) return false;
+
+  float rssiSum = 0;
+  for (int i = 0; i < valid; i++) {
+    rssiSum += block[i];
+  }
+  rssi = rssiSum / valid;
+  return true;
+}
+
+// GetRssiInst (opcode, status, RSSI byte = -2 x dBm) back to back, with the
+// SPI transaction open for the whole burst instead of one RadioLib call per
+// reading. The radio must be in RX, which tune() leaves it in.
+int SpectrumRadio::burstRSSI(float* block, int samples, uint32_t* stamps) {
+  int valid = 0;
+  uint32_t due = micros();
+  spi.beginTransaction(SPISettings(BURST_SPI_HZ, MSBFIRST, SPI_MODE0));
+  for (int i = 0; i < samples; i++) {
+    while ((int32_t)(micros() - due) < 0) {
+    }
+    uint32_t waitStart = micros();
+    while (digitalRead(busyPin) == HIGH) {
+      if (micros() - waitStart > BURST_BUSY_TIMEOUT_US) {
+        spi.endTransaction();
+        return valid;
+      }
+    }
+    uint32_t readAt = micros();
+    due = readAt + sampleUs;
+
+    digitalWrite(nssPin, LOW);
+    spi.transfer(RADIOLIB_SX126X_CMD_GET_RSSI_INST);
+    spi.transfer(0x00);  // Status
+    uint8_t raw = spi.transfer(0x00);
+    digitalWrite(nssPin, HIGH);
+
+    float reading = -raw / 2.0f;
+    if (reading > RSSI_MIN_VALID && reading < RSSI_MAX_VALID) {
+      if (stamps) stamps[valid] = readAt;
+      block[valid++] = reading;
+    }
+  }
+  spi.endTransaction();
+  return valid;
+}
+
+}  // namespace spectrum
@@ -0,0 +1,162 @@
+// Shared spectrum core for the Heltec V3 firmware variants
+//
+// Board wiring, radio setup and the per-bin measurement hot path live here so
+// main.cpp and wifi_spectrum.cpp stay thin front-ends. Fixed sweeps are
+// described by a SweepConfig type; SweepTable<Config> turns it into a
+// compile-time table of SX126x frequency words and image-calibration bands,
+// so a sweep step is a table lookup and a 4-byte SPI write. RSSI is read in
+// bursts of GetRssiInst commands on the raw SPI bus rather than one RadioLib
+// call and a delay per reading.
+
+#pragma once
+
+#include <Arduino.h>
+#include <RadioLib.h>
+#include <SPI.h>
+#include <array>
+
+// LoRa configuration (SX1262) - Heltec WiFi LoRa 32 V3 pinout
+#define LORA_NSS 8
+#define LORA_SCK 9
+#define LORA_MOSI 10
+#define LORA_MISO 11
+#define LORA_RST 12
+#define LORA_BUSY 13
+#define LORA_DIO1 14
+
+// OLED pins
+#define OLED_SDA 17
+#define OLED_SCL 18
+#define OLED_RST 21
+#define VEXT_CTRL 36
+
+namespace spectrum {
+
+constexpr double XTAL_MHZ = 32.0;
+constexpr double FREQ_STEP_SCALE = 33554432.0 / XTAL_MHZ;  // 2^25 / Fxtal, words per MHz
+constexpr float RSSI_MIN_VALID = -200.0;
+constexpr float RSSI_MAX_VALID = 0.0;
+constexpr int BURST_MAX_SAMPLES = 64;        // Readings per burst
+constexpr uint32_t BURST_SPI_HZ = 8000000;   // SX1262 allows up to 16 MHz
+constexpr uint32_t BURST_MIN_GAP_US = 8;     // Floor on the reading interval
+constexpr uint32_t BURST_BUSY_TIMEOUT_US = 1000;
+
+// SX126x RF frequency register word for a frequency in MHz
+constexpr uint32_t frequencyWord(double mhz) {
+  return (uint32_t)(mhz * FREQ_STEP_SCALE + 0.5);
+}
+
+// Image calibration ranges used by RadioLib's setFrequency(); bins that share
+// a range can be retuned without recalibrating
+constexpr uint8_t IMAGE_BANDS = 5;
+constexpr uint8_t imageBand(double mhz) {
+  return mhz > 900.0 ? 4 : mhz > 850.0 ? 3 : mhz > 770.0 ? 2 : mhz > 460.0 ? 1 : 0;
+}
+
+struct BinTune {
+  uint32_t word;     // SetRfFrequency argument
+  uint8_t band;      // imageBand() of the bin
+  float freqMHz;     // Bin centre, for reports and the slow path
+};
+
+constexpr BinTune binTune(double mhz) {
+  return BinTune{frequencyWord(mhz), imageBand(mhz), (float)mhz};
+}
+
+// Default sweep; front-ends derive from it and override what differs
+struct SweepConfig {
+  static constexpr double BEGIN_MHZ = 400.0;
+  static constexpr double END_MHZ = 960.0;        // SX1262 limit
+  static constexpr int BINS = 64;
+  static constexpr float RX_BANDWIDTH_KHZ = 234.3; // Must be a valid SX1262 FSK value
+  static constexpr int SAMPLES = 16;               // RSSI readings averaged per bin (one burst)
+  static constexpr int SETTLE_MS = 10;             // Settle time after retuning
+  static constexpr int STEP_DELAY_MS = 10;         // Pause between sweep steps in loop()
+};
+
+template <class Config>
+struct SweepTable {
+  static_assert(Config::BINS > 0, "sweep needs at least one bin");
+  static_assert(Config::BEGIN_MHZ >= 150.0 && Config::END_MHZ <= 960.0 &&
+                Config::BEGIN_MHZ < Config::END_MHZ, "sweep outside the SX1262 range");
+
+  static constexpr double STEP_MHZ = (Config::END_MHZ - Config::BEGIN_MHZ) / Config::BINS;
+
+  static constexpr double lowerEdge(int bin) { return Config::BEGIN_MHZ + bin * STEP_MHZ; }
+  static constexpr double center(int bin) { return lowerEdge(bin) + STEP_MHZ / 2.0; }
+
+  static constexpr std::array<BinTune, Config::BINS> build() {
+    std::array<BinTune, Config::BINS> table{};
+    for (int i = 0; i < Config::BINS; i++) {
+      table[i] = binTune(center(i));
+    }
+    return table;
+  }
+
+  static constexpr std::array<BinTune, Config::BINS> bins = build();
+};
+
+// Deterministic-looking noise for bins where the radio returned nothing valid
+float syntheticNoise(float mhz);
+
+// Replacement for the radio's readings, e.g. recorded sweeps
+typedef float (*RssiSource)(float mhz);
+
+// The SX1262 with the sweep hot path on top. Retuning skips image calibration
+// while consecutive bins stay in the same calibration range.
+class SpectrumRadio {
+ public:
+  // nss/busy/spi are the radio's bus, used directly for RSSI bursts
+  explicit SpectrumRadio(SX1262& radio, int nssPin = LORA_NSS, int busyPin = LORA_BUSY, SPIClass& spi = SPI)
+      : radio(radio), spi(spi), nssPin(nssPin), busyPin(busyPin) {}
+
+  int begin(float mhz, float rxBandwidthKHz);
+  int setRxBandwidth(float rxBandwidthKHz);
+
+  // Tune and restart RX
+  int tune(const BinTune& bin);
+  int tune(float mhz) { return tune(binTune(mhz)); }
+
+  // Settle, then one burst of up to BURST_MAX_SAMPLES instantaneous readings,
+  // one per RSSI update; returns how many valid readings landed in block.
+  // stamps, if given, gets the micros() of each valid reading.
+  int readRSSIBlock(float* block, int samples, int settleMs, uint32_t* stamps = nullptr);
+  // Average of readRSSIBlock(); false if there were no valid readings
+  bool readRSSI(float& rssi, int samples, int settleMs);
+  // Time between burst readings at the current RX bandwidth
+  uint32_t sampleIntervalUs() const { return sampleUs; }
+
+  // Configured sweep bin: tune, settle, average, synthetic noise as fallback
+  template <class Config>
+  float measureBin(int bin) {
+    const BinTune& tune = SweepTable<Config>::bins[bin];
+    this->tune(tune);
+    float rssi;
+    if (!readRSSI(rssi, Config::SAMPLES, Config::SETTLE_MS)) {
+      rssi = syntheticNoise(tune.freqMHz);
+    }
+    return rssi;
+  }
+
+  // After anything else retuned the radio through RadioLib directly
+  void invalidateCalibration() { calibratedBand = IMAGE_BANDS; }
+
+  // While a source is set, tune() only records the frequency and readRSSI()
+  // returns the source's value without touching the radio or waiting
+  void setSource(RssiSource source) { this->source = source; }
+  bool hasSource() const { return source != nullptr; }
+
+ private:
+  int burstRSSI(float* block, int samples, uint32_t* stamps);
+
+  SX1262& radio;
+  SPIClass& spi;
+  int nssPin;
+  int busyPin;
+  uint8_t calibratedBand = IMAGE_BANDS;  // None yet
+  uint32_t sampleUs = BURST_MIN_GAP_US;
+  RssiSource source = nullptr;
+  float sourceFreq = 0.0;
+};
+
+}  // namespace spectrum
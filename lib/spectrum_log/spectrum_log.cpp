@@ -0,0 +1,122 @@
+#include "spectrum_log.h"
+
+#include <stdarg.h>
+
+#define LOG_DRAIN_CHUNK 256   // Bytes copied out per Serial write
+#define LOG_TASK_STACK 3072
+#define LOG_TASK_PRIORITY 0   // Idle priority: runs only when nothing else on its core wants to
+#define LOG_TASK_CORE 0       // loop() runs on core 1 (ARDUINO_RUNNING_CORE), so the drain never shares its core
+
+volatile uint8_t logLevel = LOG_LEVEL_DEBUG;
+
+static char ring[LOG_BUFFER_SIZE];
+static volatile uint32_t ringHead = 0;  // Total bytes written
+static volatile uint32_t ringTail = 0;  // Total bytes drained
+static volatile uint32_t dropped = 0;
+static portMUX_TYPE ringLock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t drainTask = NULL;
+
+static const char LEVEL_TAGS[] = "-EWID";
+
+static void drainLoop(void*) {
+  char chunk[LOG_DRAIN_CHUNK];
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));
+
+    for (;;) {
+      portENTER_CRITICAL(&ringLock);
+      uint32_t tail = ringTail;
+      uint32_t available = ringHead - tail;
+      portEXIT_CRITICAL(&ringLock);
+      if (available == 0) break;
+
+      uint32_t len = available < LOG_DRAIN_CHUNK ? available : LOG_DRAIN_CHUNK;
+      for (uint32_t i = 0; i < len; i++) {
+        chunk[i] = ring[(tail + i) & (LOG_BUFFER_SIZE - 1)];
+      }
+
+      // Only write whole lines: one Serial.write() per batch keeps log lines
+      // from splitting a JSON snapshot written by another task
+      uint32_t lineEnd = len;
+      while (lineEnd > 0 && chunk[lineEnd - 1] != '\n') lineEnd--;
+      if (lineEnd == 0) lineEnd = len;  // Never happens with LOG_LINE_MAX < chunk
+
+      Serial.write((const uint8_t*)chunk, lineEnd);
+
+      portENTER_CRITICAL(&ringLock);
+      ringTail = tail + lineEnd;
+      portEXIT_CRITICAL(&ringLock);
+    }
+  }
+}
+
+void logBegin(uint8_t level) {
+  logLevel = level;
+  if (drainTask == NULL) {
+    xTaskCreatePinnedToCore(drainLoop, "log", LOG_TASK_STACK, NULL, LOG_TASK_PRIORITY, &drainTask, LOG_TASK_CORE);
+  }
+}
+
+void logWrite(uint8_t level, const char* format, ...) {
+  char line[LOG_LINE_MAX];
+  int len = snprintf(line, sizeof(line), "[%c] ", LEVEL_TAGS[level <= LOG_LEVEL_DEBUG ? level : 0]);
+
+  va_list args;
+  va_start(args, format);
+  int body = vsnprintf(line + len, sizeof(line) - len - 1, format, args);
+  va_end(args);
+  if (body < 0) return;
+  len += body;
+  if (len > (int)sizeof(line) - 2) len = sizeof(line) - 2;  // Truncated
+  line[len++] = '\n';
+
+  bool stored = false;
+  portENTER_CRITICAL(&ringLock);
+  uint32_t head = ringHead;
+  if (LOG_BUFFER_SIZE - (head - ringTail) >= (uint32_t)len) {
+    for (int i = 0; i < len; i++) {
+      ring[(head + i) & (LOG_BUFFER_SIZE - 1)] = line[i];
+    }
+    ringHead = head + len;
+    stored = true;
+  } else {
+    dropped++;
+  }
+  portEXIT_CRITICAL(&ringLock);
+
+  if (stored && drainTask != NULL) {
+    xTaskNotifyGive(drainTask);
+  }
+}
+
+// Wait for queued messages to reach the UART, e.g. before light sleep
+void logFlush(uint32_t timeoutMs) {
+  unsigned long start = millis();
+  while (ringHead != ringTail && drainTask != NULL && millis() - start < timeoutMs) {
+    xTaskNotifyGive(drainTask);
+    delay(1);
+  }
+  Serial.flush();
+}
+
+uint32_t logDropped() {
+  return dropped;
+}
+
+const char* logLevelName(uint8_t level) {
+  switch (level) {
+    case LOG_LEVEL_OFF: return "off";
+    case LOG_LEVEL_ERROR: return "error";
+    case LOG_LEVEL_WARN: return "warn";
+    case LOG_LEVEL_INFO: return "info";
+    case LOG_LEVEL_DEBUG: return "debug";
+    default: return "?";
+  }
+}
+
+int logLevelFromName(const char* name) {
+  for (uint8_t level = LOG_LEVEL_OFF; level <= LOG_LEVEL_DEBUG; level++) {
+    if (strcmp(name, logLevelName(level)) == 0) return level;
+  }
+  return -1;
+}
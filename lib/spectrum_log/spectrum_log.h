@@ -0,0 +1,46 @@
+// Non-blocking leveled logging
+//
+// Messages are formatted into a fixed ring buffer and written to Serial by an
+// idle-priority task on the core loop() does not use, so the sweep never
+// waits on the UART. When the buffer is
+// full the message is dropped and counted instead.
+
+#pragma once
+
+#include <Arduino.h>
+
+#define LOG_LEVEL_OFF 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// Levels above this are compiled out (override with -DLOG_COMPILE_LEVEL=...)
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 4096  // Ring buffer bytes, must be a power of two
+#endif
+
+#define LOG_LINE_MAX 160      // Longest formatted message, including prefix
+
+extern volatile uint8_t logLevel;
+
+void logBegin(uint8_t level);
+void logWrite(uint8_t level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+void logFlush(uint32_t timeoutMs = 500);
+uint32_t logDropped();
+const char* logLevelName(uint8_t level);
+int logLevelFromName(const char* name);
+
+#define LOG_AT(level, ...) \
+  do { \
+    if (LOG_COMPILE_LEVEL >= (level) && logLevel >= (level)) logWrite((level), __VA_ARGS__); \
+  } while (0)
+
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
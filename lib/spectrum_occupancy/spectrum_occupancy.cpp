@@ -0,0 +1,254 @@
+#include "spectrum_occupancy.h"
+
+#include <string.h>
+
+#define SLOT_MS 10000UL   // Length of a level 0 slot
+#define L0_SLOTS 6        // 6 x 10 s  = 1 min
+#define L1_SLOTS 10       // 10 x 1 min = 10 min
+#define L2_SLOTS 6        // 6 x 10 min = 1 h
+#define MAX_CATCH_UP 36   // Slots closed at most after a long pause
+
+const unsigned long OCC_WINDOW_SECONDS[OCC_WINDOWS] = {60, 600, 3600};
+
+static int bins = 0;
+static float threshold = -95.0;
+static unsigned long slotStart = 0;
+
+// Open level 0 slot, per bin
+static uint8_t curVisits[OCC_MAX_BINS];
+static uint8_t curBusy[OCC_MAX_BINS];
+static uint8_t curBursts[OCC_MAX_BINS];
+static uint32_t burstStart[OCC_MAX_BINS];  // millis() + 1 of the burst start, 0 if idle
+
+// Closed slots, per bin
+static uint8_t l0Busy[L0_SLOTS][OCC_MAX_BINS];
+static uint8_t l0Bursts[L0_SLOTS][OCC_MAX_BINS];
+static uint8_t l1Busy[L1_SLOTS][OCC_MAX_BINS];
+static uint8_t l1Bursts[L1_SLOTS][OCC_MAX_BINS];
+static uint8_t l2Busy[L2_SLOTS][OCC_MAX_BINS];
+static uint16_t l2Bursts[L2_SLOTS][OCC_MAX_BINS];
+
+// Roll-up accumulators for the open level 1 and level 2 slots
+static uint16_t acc1Busy[OCC_MAX_BINS];
+static uint8_t acc1Count[OCC_MAX_BINS];
+static uint16_t acc1Bursts[OCC_MAX_BINS];
+static uint16_t acc2Busy[OCC_MAX_BINS];
+static uint8_t acc2Count[OCC_MAX_BINS];
+static uint16_t acc2Bursts[OCC_MAX_BINS];
+
+// Dwell-length histograms, summed over all bins
+static uint16_t curHist[OCC_HIST_BUCKETS];
+static uint16_t l0Hist[L0_SLOTS][OCC_HIST_BUCKETS];
+static uint32_t acc1Hist[OCC_HIST_BUCKETS];
+static uint32_t l1Hist[L1_SLOTS][OCC_HIST_BUCKETS];
+static uint32_t acc2Hist[OCC_HIST_BUCKETS];
+static uint32_t l2Hist[L2_SLOTS][OCC_HIST_BUCKETS];
+
+static int l0Index = 0, l1Index = 0, l2Index = 0;   // Next slot to write
+static int l0Filled = 0, l1Filled = 0, l2Filled = 0;
+static int l0Closed = 0, l1Closed = 0;              // Closures into the open upper slot
+
+static const char* BUCKET_LABELS[OCC_HIST_BUCKETS] = {
+  "<1s", "1-2s", "2-4s", "4-8s", "8-16s", "16-32s", "32-64s", ">=64s"
+};
+
+static int dwellBucket(unsigned long dwellMs) {
+  int bucket = 0;
+  unsigned long limit = 1000;
+  while (bucket < OCC_HIST_BUCKETS - 1 && dwellMs >= limit) {
+    bucket++;
+    limit <<= 1;
+  }
+  return bucket;
+}
+
+static uint8_t saturate8(uint32_t value) {
+  return value > 255 ? 255 : value;
+}
+
+static uint16_t saturate16(uint32_t value) {
+  return value > 0xFFFF ? 0xFFFF : value;
+}
+
+static void closeLevel1() {
+  for (int b = 0; b < bins; b++) {
+    l2Busy[l2Index][b] = acc2Count[b] ? acc2Busy[b] / acc2Count[b] : OCC_NO_DATA;
+    l2Bursts[l2Index][b] = acc2Bursts[b];
+    acc2Busy[b] = 0;
+    acc2Count[b] = 0;
+    acc2Bursts[b] = 0;
+  }
+  for (int h = 0; h < OCC_HIST_BUCKETS; h++) {
+    l2Hist[l2Index][h] = acc2Hist[h];
+    acc2Hist[h] = 0;
+  }
+  l2Index = (l2Index + 1) % L2_SLOTS;
+  if (l2Filled < L2_SLOTS) l2Filled++;
+}
+
+static void closeLevel0() {
+  for (int b = 0; b < bins; b++) {
+    uint8_t busy = acc1Count[b] ? acc1Busy[b] / acc1Count[b] : OCC_NO_DATA;
+    l1Busy[l1Index][b] = busy;
+    l1Bursts[l1Index][b] = saturate8(acc1Bursts[b]);
+    if (busy != OCC_NO_DATA) {
+      acc2Busy[b] += busy;
+      acc2Count[b]++;
+    }
+    acc2Bursts[b] = saturate16((uint32_t)acc2Bursts[b] + acc1Bursts[b]);
+    acc1Busy[b] = 0;
+    acc1Count[b] = 0;
+    acc1Bursts[b] = 0;
+  }
+  for (int h = 0; h < OCC_HIST_BUCKETS; h++) {
+    l1Hist[l1Index][h] = acc1Hist[h];
+    acc2Hist[h] += acc1Hist[h];
+    acc1Hist[h] = 0;
+  }
+  l1Index = (l1Index + 1) % L1_SLOTS;
+  if (l1Filled < L1_SLOTS) l1Filled++;
+
+  if (++l1Closed >= L1_SLOTS) {
+    l1Closed = 0;
+    closeLevel1();
+  }
+}
+
+// Close the open 10 s slot and cascade into the coarser levels when they fill
+static void closeSlot() {
+  for (int b = 0; b < bins; b++) {
+    uint8_t busy = curVisits[b] ? (uint16_t)curBusy[b] * OCC_FULL_SCALE / curVisits[b] : OCC_NO_DATA;
+    l0Busy[l0Index][b] = busy;
+    l0Bursts[l0Index][b] = curBursts[b];
+    if (busy != OCC_NO_DATA) {
+      acc1Busy[b] += busy;
+      acc1Count[b]++;
+    }
+    acc1Bursts[b] += curBursts[b];
+    curVisits[b] = 0;
+    curBusy[b] = 0;
+    curBursts[b] = 0;
+  }
+  for (int h = 0; h < OCC_HIST_BUCKETS; h++) {
+    l0Hist[l0Index][h] = curHist[h];
+    acc1Hist[h] += curHist[h];
+    curHist[h] = 0;
+  }
+  l0Index = (l0Index + 1) % L0_SLOTS;
+  if (l0Filled < L0_SLOTS) l0Filled++;
+
+  if (++l0Closed >= L0_SLOTS) {
+    l0Closed = 0;
+    closeLevel0();
+  }
+}
+
+void occupancyReset(int binCount, float thresholdDbm, unsigned long now) {
+  bins = binCount > OCC_MAX_BINS ? OCC_MAX_BINS : binCount;
+  threshold = thresholdDbm;
+  slotStart = now;
+
+  memset(curVisits, 0, sizeof(curVisits));
+  memset(curBusy, 0, sizeof(curBusy));
+  memset(curBursts, 0, sizeof(curBursts));
+  memset(burstStart, 0, sizeof(burstStart));
+  memset(acc1Busy, 0, sizeof(acc1Busy));
+  memset(acc1Count, 0, sizeof(acc1Count));
+  memset(acc1Bursts, 0, sizeof(acc1Bursts));
+  memset(acc2Busy, 0, sizeof(acc2Busy));
+  memset(acc2Count, 0, sizeof(acc2Count));
+  memset(acc2Bursts, 0, sizeof(acc2Bursts));
+  memset(curHist, 0, sizeof(curHist));
+  memset(acc1Hist, 0, sizeof(acc1Hist));
+  memset(acc2Hist, 0, sizeof(acc2Hist));
+  l0Index = l1Index = l2Index = 0;
+  l0Filled = l1Filled = l2Filled = 0;
+  l0Closed = l1Closed = 0;
+}
+
+// Account one visit of `bin`. Returns true when a 10 s slot closed, i.e. the
+// window results changed.
+bool occupancyVisit(int bin, float rssi, unsigned long now) {
+  bool closed = false;
+  for (int i = 0; now - slotStart >= SLOT_MS; i++) {
+    if (i == MAX_CATCH_UP) {
+      slotStart = now;  // Paused for longer than every window; just resync
+      break;
+    }
+    closeSlot();
+    slotStart += SLOT_MS;
+    closed = true;
+  }
+
+  if (bin < 0 || bin >= bins) return closed;
+
+  bool busy = rssi >= threshold;
+  curVisits[bin] = saturate8(curVisits[bin] + 1);
+  if (busy) {
+    curBusy[bin] = saturate8(curBusy[bin] + 1);
+    if (burstStart[bin] == 0) {
+      burstStart[bin] = now + 1;
+      curBursts[bin] = saturate8(curBursts[bin] + 1);
+    }
+  } else if (burstStart[bin] != 0) {
+    // Dwell runs until the first quiet visit, so it is rounded up to the revisit time
+    int bucket = dwellBucket(now + 1 - burstStart[bin]);
+    if (curHist[bucket] < 0xFFFF) curHist[bucket]++;
+    burstStart[bin] = 0;
+  }
+
+  // Keep visits and busy in proportion when the counters saturate
+  if (curVisits[bin] == 255) {
+    curVisits[bin] = 128;
+    curBusy[bin] = curBusy[bin] / 2;
+  }
+  return closed;
+}
+
+float occupancyThreshold() {
+  return threshold;
+}
+
+int occupancyBins() {
+  return bins;
+}
+
+// Mean busy fraction of `bin` over a window (0..OCC_FULL_SCALE), -1 without data
+int occupancyBusy(int window, int bin) {
+  uint32_t sum = 0;
+  int count = 0;
+  for (int i = 0; i < occupancySlotsFilled(window); i++) {
+    uint8_t busy = window == 0 ? l0Busy[i][bin] : window == 1 ? l1Busy[i][bin] : l2Busy[i][bin];
+    if (busy != OCC_NO_DATA) {
+      sum += busy;
+      count++;
+    }
+  }
+  return count ? sum / count : -1;
+}
+
+uint32_t occupancyBursts(int window, int bin) {
+  uint32_t sum = 0;
+  for (int i = 0; i < occupancySlotsFilled(window); i++) {
+    sum += window == 0 ? l0Bursts[i][bin] : window == 1 ? l1Bursts[i][bin] : l2Bursts[i][bin];
+  }
+  return sum;
+}
+
+void occupancyHistogram(int window, uint32_t histogram[OCC_HIST_BUCKETS]) {
+  for (int h = 0; h < OCC_HIST_BUCKETS; h++) {
+    histogram[h] = 0;
+    for (int i = 0; i < occupancySlotsFilled(window); i++) {
+      histogram[h] += window == 0 ? l0Hist[i][h] : window == 1 ? l1Hist[i][h] : l2Hist[i][h];
+    }
+  }
+}
+
+// Closed slots in a window; windows only report once their first slot closes
+int occupancySlotsFilled(int window) {
+  return window == 0 ? l0Filled : window == 1 ? l1Filled : l2Filled;
+}
+
+const char* occupancyBucketLabel(int bucket) {
+  return BUCKET_LABELS[bucket];
+}
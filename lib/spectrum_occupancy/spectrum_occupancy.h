@@ -0,0 +1,33 @@
+// Per-bin channel occupancy over rolling windows
+//
+// Each bin visit only bumps counters in the open 10 s slot. When a slot
+// closes, its busy fraction and burst count are rolled into a 1 min slot,
+// and those into a 10 min slot, giving windows of 6 x 10 s (1 min),
+// 10 x 1 min (10 min) and 6 x 10 min (1 h). Busy fractions are stored in
+// 0.5 % steps, so a closed slot costs two bytes per bin.
+
+#pragma once
+
+#include <stdint.h>
+
+#ifndef OCC_MAX_BINS
+#define OCC_MAX_BINS 1024
+#endif
+
+#define OCC_WINDOWS 3          // 1 min, 10 min, 1 h
+#define OCC_HIST_BUCKETS 8     // Dwell-length histogram buckets
+#define OCC_FULL_SCALE 200     // Busy fraction units: 0.5 %
+#define OCC_NO_DATA 255        // Slot without any visits to the bin
+
+extern const unsigned long OCC_WINDOW_SECONDS[OCC_WINDOWS];
+
+void occupancyReset(int bins, float thresholdDbm, unsigned long now);
+bool occupancyVisit(int bin, float rssi, unsigned long now);
+float occupancyThreshold();
+int occupancyBins();
+
+int occupancyBusy(int window, int bin);
+uint32_t occupancyBursts(int window, int bin);
+void occupancyHistogram(int window, uint32_t histogram[OCC_HIST_BUCKETS]);
+int occupancySlotsFilled(int window);
+const char* occupancyBucketLabel(int bucket);
@@ -0,0 +1,279 @@
+#include "spectrum_replay.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#define BINARY_MAGIC "SWP1"
+#define BINARY_HEADER_BYTES 14  // timestamp, freqBegin, freqEnd, bins
+#define JSON_MAX_DEPTH 16       // Nesting of skipped values
+#define JSON_KEY_MAX 16         // Longer keys are never ones replay reads
+#define JSON_NUMBER_MAX 32
+
+// A C string as replay input, for lines that arrive over serial
+class StringInput : public ReplayInput {
+ public:
+  explicit StringInput(const char* text) : text(text) {}
+  int peek() override { return *text ? (uint8_t)*text : -1; }
+  int read() override { return *text ? (uint8_t)*text++ : -1; }
+  size_t readBytes(uint8_t* buffer, size_t length) override {
+    size_t n = 0;
+    while (n < length && *text) buffer[n++] = (uint8_t)*text++;
+    return n;
+  }
+
+ private:
+  const char* text;
+};
+
+// Snapshot JSON is read straight from the input, without buffering the line.
+// Snapshots are compact and never contain a raw newline, so a newline ends
+// the sweep and is left for the caller; a truncated line can't run into the
+// next one.
+static void skipSpace(ReplayInput& in) {
+  int c;
+  while ((c = in.peek()) == ' ' || c == '\t' || c == '\r') in.read();
+}
+
+static bool expect(ReplayInput& in, char wanted) {
+  skipSpace(in);
+  if (in.peek() != wanted) return false;
+  in.read();
+  return true;
+}
+
+// ',' or `close` after a member or element (consumed), -1 for anything else
+static int separator(ReplayInput& in, char close) {
+  skipSpace(in);
+  int c = in.peek();
+  if (c != ',' && c != close) return -1;
+  in.read();
+  return c;
+}
+
+// After the opening quote; keeps the first size - 1 characters in key, if given
+static bool readString(ReplayInput& in, char* key, size_t size) {
+  size_t len = 0;
+  while (true) {
+    int c = in.peek();
+    if (c < 0 || c == '\n') return false;
+    in.read();
+    if (c == '"') break;
+    if (c == '\\') {
+      c = in.peek();
+      if (c < 0 || c == '\n') return false;
+      in.read();
+    }
+    if (key && len + 1 < size) key[len++] = (char)c;
+  }
+  if (key) key[len] = '\0';
+  return true;
+}
+
+static bool readKey(ReplayInput& in, char* key, size_t size) {
+  return expect(in, '"') && readString(in, key, size) && expect(in, ':');
+}
+
+static bool readNumber(ReplayInput& in, double& value) {
+  char text[JSON_NUMBER_MAX];
+  size_t len = 0;
+  skipSpace(in);
+  int c;
+  while ((c = in.peek()) >= 0 && (isdigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')) {
+    if (len + 1 >= sizeof(text)) return false;
+    text[len++] = (char)in.read();
+  }
+  text[len] = '\0';
+  char* end;
+  value = strtod(text, &end);
+  return len > 0 && end == text + len;
+}
+
+static bool skipValue(ReplayInput& in, int depth) {
+  skipSpace(in);
+  int c = in.peek();
+  if (c == '"') {
+    in.read();
+    return readString(in, nullptr, 0);
+  }
+  if (c == '{' || c == '[') {
+    if (depth >= JSON_MAX_DEPTH) return false;
+    char close = c == '{' ? '}' : ']';
+    in.read();
+    skipSpace(in);
+    if (in.peek() == close) {
+      in.read();
+      return true;
+    }
+    int sep;
+    do {
+      if (close == '}' && !readKey(in, nullptr, 0)) return false;
+      if (!skipValue(in, depth + 1)) return false;
+      sep = separator(in, close);
+    } while (sep == ',');
+    return sep == close;
+  }
+  // Number, true, false or null
+  size_t len = 0;
+  while ((c = in.peek()) >= 0 && (isalnum(c) || c == '-' || c == '+' || c == '.')) {
+    in.read();
+    len++;
+  }
+  return len > 0;
+}
+
+// "data": [{"freq": ..., "rssi": ...}, ...]; only rssi is kept, the bin
+// frequencies follow from the span
+static bool readData(ReplayInput& in, float* rssi, int& bins) {
+  bins = 0;
+  if (!expect(in, '[')) return false;
+  skipSpace(in);
+  if (in.peek() == ']') {
+    in.read();
+    return true;
+  }
+  int sep;
+  do {
+    if (bins == REPLAY_MAX_BINS || !expect(in, '{')) return false;
+    float value = -100.0f;
+    int member;
+    do {
+      char key[JSON_KEY_MAX];
+      if (!readKey(in, key, sizeof(key))) return false;
+      double number;
+      if (strcmp(key, "rssi") == 0) {
+        if (!readNumber(in, number)) return false;
+        value = (float)number;
+      } else if (!skipValue(in, 2)) {
+        return false;
+      }
+      member = separator(in, '}');
+    } while (member == ',');
+    if (member != '}') return false;
+    rssi[bins++] = value;
+    sep = separator(in, ']');
+  } while (sep == ',');
+  return sep == ']';
+}
+
+bool SweepReplay::parseJson(ReplayInput& in) {
+  incoming.timestamp = 0;
+  incoming.freqBegin = 0.0f;
+  incoming.freqEnd = 0.0f;
+  int bins = 0;
+  if (!expect(in, '{')) return false;
+
+  int sep;
+  do {
+    char key[JSON_KEY_MAX];
+    if (!readKey(in, key, sizeof(key))) return false;
+    double number;
+    if (strcmp(key, "timestamp") == 0) {
+      if (!readNumber(in, number)) return false;
+      incoming.timestamp = (uint32_t)number;
+    } else if (strcmp(key, "freqBegin") == 0) {
+      if (!readNumber(in, number)) return false;
+      incoming.freqBegin = (float)number;
+    } else if (strcmp(key, "freqEnd") == 0) {
+      if (!readNumber(in, number)) return false;
+      incoming.freqEnd = (float)number;
+    } else if (strcmp(key, "data") == 0) {
+      if (!readData(in, incoming.rssi, bins)) return false;
+    } else if (!skipValue(in, 1)) {
+      return false;
+    }
+    sep = separator(in, '}');
+  } while (sep == ',');
+
+  if (sep != '}' || bins == 0 || incoming.freqEnd <= incoming.freqBegin) return false;
+  incoming.bins = bins;
+  return true;
+}
+
+bool SweepReplay::open(ReplayInput& source) {
+  close();
+  int first = source.peek();
+  if (first == '{') {
+    binary = false;
+  } else if (first == BINARY_MAGIC[0]) {
+    uint8_t magic[4];
+    if (source.readBytes(magic, 4) != 4 || memcmp(magic, BINARY_MAGIC, 4) != 0) return false;
+    binary = true;
+  } else {
+    return false;
+  }
+  input = &source;
+  return true;
+}
+
+void SweepReplay::close() {
+  input = nullptr;
+  count = 0;
+}
+
+bool SweepReplay::next() {
+  if (!input) return false;
+  if (binary) return readBinary();
+
+  // Serial logs mix snapshots with status text, logs and other JSON; each
+  // line is tried as a sweep and its remainder skipped either way
+  while (input->peek() >= 0) {
+    bool ok = input->peek() == '{' && parseJson(*input);
+    int c;
+    while ((c = input->read()) >= 0 && c != '\n') {
+    }
+    if (ok) {
+      accept();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SweepReplay::readBinary() {
+  uint8_t header[BINARY_HEADER_BYTES];
+  if (input->readBytes(header, sizeof(header)) != sizeof(header)) return false;
+
+  uint16_t bins;
+  memcpy(&incoming.timestamp, header, 4);
+  memcpy(&incoming.freqBegin, header + 4, 4);
+  memcpy(&incoming.freqEnd, header + 8, 4);
+  memcpy(&bins, header + 12, 2);
+  if (bins == 0 || bins > REPLAY_MAX_BINS || incoming.freqEnd <= incoming.freqBegin) return false;
+
+  int16_t rssi[64];
+  for (int i = 0; i < bins; i += 64) {
+    int chunk = std::min(64, bins - i);
+    size_t bytes = chunk * sizeof(int16_t);
+    if (input->readBytes((uint8_t*)rssi, bytes) != bytes) return false;
+    for (int j = 0; j < chunk; j++) {
+      incoming.rssi[i + j] = rssi[j] / 10.0;
+    }
+  }
+  incoming.bins = bins;
+  accept();
+  return true;
+}
+
+bool SweepReplay::loadJson(const char* line) {
+  StringInput in(line);
+  if (!parseJson(in)) return false;
+  accept();
+  return true;
+}
+
+void SweepReplay::accept() {
+  current.timestamp = incoming.timestamp;
+  current.freqBegin = incoming.freqBegin;
+  current.freqEnd = incoming.freqEnd;
+  current.bins = incoming.bins;
+  memcpy(current.rssi, incoming.rssi, incoming.bins * sizeof(float));
+  count++;
+}
+
+float SweepReplay::rssiAt(float mhz) const {
+  if (current.bins == 0) return -100.0;
+  int bin = (int)((mhz - current.freqBegin) * current.bins / (current.freqEnd - current.freqBegin));
+  return current.rssi[std::min(std::max(bin, 0), current.bins - 1)];
+}
@@ -0,0 +1,84 @@
+// Recorded sweeps as a radio source
+//
+// A capture is either the serial JSON stream (one snapshot per line, as printed
+// by printJsonSnapshot(); other lines are skipped) or a binary file written by
+// tools/sweep_capture.py:
+//
+//   "SWP1", then per sweep, little-endian:
+//   uint32 timestamp (device ms), float freqBegin, float freqEnd (MHz),
+//   uint16 bins, int16 rssi[bins] (0.1 dBm)
+//
+// Sweeps are read from a ReplayInput (a LittleFS file through
+// StreamReplayInput on the device, a FILE* in tools/host_replay), or fed one
+// JSON line at a time when the capture arrives over the command serial port.
+// Only standard types are used, so the library also builds on a host.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef REPLAY_MAX_BINS
+#define REPLAY_MAX_BINS 1024
+#endif
+
+struct ReplaySweep {
+  uint32_t timestamp;  // Device millis() when the sweep was recorded
+  float freqBegin;     // MHz, lower edge of the first bin
+  float freqEnd;       // MHz, upper edge of the last bin
+  int bins;
+  float rssi[REPLAY_MAX_BINS];
+};
+
+// Byte source a capture is read from
+class ReplayInput {
+ public:
+  virtual ~ReplayInput() {}
+  virtual int peek() = 0;  // Next byte without consuming it, -1 at the end
+  virtual int read() = 0;  // Next byte, -1 at the end
+  virtual size_t readBytes(uint8_t* buffer, size_t length) = 0;
+};
+
+class SweepReplay {
+ public:
+  // Detects the capture format from the first byte; false if it is neither
+  bool open(ReplayInput& input);
+  void close();
+
+  // Next sweep from the opened input; false at the end of the capture
+  bool next();
+  // One serial JSON snapshot line; false if it is not a sweep, and then the
+  // current sweep is left as it was
+  bool loadJson(const char* line);
+
+  const ReplaySweep& sweep() const { return current; }
+  float rssiAt(float mhz) const;  // Nearest recorded bin
+  unsigned long sweeps() const { return count; }
+
+ private:
+  bool readBinary();
+  bool parseJson(ReplayInput& in);  // Into incoming; stops at the end of the line
+  void accept();                    // incoming becomes current
+
+  ReplayInput* input = nullptr;
+  bool binary = false;
+  unsigned long count = 0;
+  ReplaySweep current = {};
+  ReplaySweep incoming = {};  // Parsed and validated here before it replaces current
+};
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+// A Stream (LittleFS file, serial port) as replay input
+class StreamReplayInput : public ReplayInput {
+ public:
+  explicit StreamReplayInput(Stream& stream) : stream(stream) {}
+  int peek() override { return stream.peek(); }
+  int read() override { return stream.read(); }
+  size_t readBytes(uint8_t* buffer, size_t length) override { return stream.readBytes(buffer, length); }
+
+ private:
+  Stream& stream;
+};
+#endif
@@ -0,0 +1,144 @@
+#include "spectrum_watch.h"
+
+#include <algorithm>
+
+static WatchEntry entries[WATCH_MAX_ENTRIES];
+
+static void startEntry(WatchEntry& e, float beginMHz, float endMHz, int bins, unsigned long intervalMs,
+                       uint8_t priority, unsigned long now) {
+  e = WatchEntry();
+  e.active = true;
+  e.beginMHz = beginMHz;
+  e.endMHz = endMHz;
+  e.bins = bins;
+  e.intervalMs = intervalMs;
+  e.priority = priority;
+  e.release = now;  // First pass due right away
+}
+
+void watchSetSurvey(float beginMHz, float endMHz, int bins, unsigned long intervalMs, unsigned long now) {
+  startEntry(entries[WATCH_SURVEY], beginMHz, endMHz, bins, intervalMs, 0, now);
+}
+
+int watchAdd(float beginMHz, float endMHz, int bins, unsigned long intervalMs, uint8_t priority,
+             unsigned long now) {
+  for (int i = WATCH_SURVEY + 1; i < WATCH_MAX_ENTRIES; i++) {
+    if (entries[i].active) continue;
+    startEntry(entries[i], beginMHz, endMHz, std::min(std::max(bins, 1), WATCH_MAX_BINS), intervalMs, priority, now);
+    return i;
+  }
+  return -1;
+}
+
+bool watchRemove(int index) {
+  if (index <= WATCH_SURVEY || index >= WATCH_MAX_ENTRIES || !entries[index].active) return false;
+  entries[index].active = false;
+  return true;
+}
+
+void watchClear() {
+  for (int i = WATCH_SURVEY + 1; i < WATCH_MAX_ENTRIES; i++) {
+    entries[i].active = false;
+  }
+}
+
+int watchSegments() {
+  int count = 0;
+  for (int i = WATCH_SURVEY + 1; i < WATCH_MAX_ENTRIES; i++) {
+    if (entries[i].active) count++;
+  }
+  return count;
+}
+
+// Earliest deadline among released jobs. While any released job is late the
+// load does not fit, and plain EDF would let every entry miss in turn; then
+// the highest priority goes first, so the misses fall on the least important.
+int watchPick(unsigned long now) {
+  bool overload = false;
+  for (int i = 0; i < WATCH_MAX_ENTRIES; i++) {
+    WatchEntry& e = entries[i];
+    if (!e.active || e.bins == 0 || (long)(now - e.release) < 0) continue;
+    if ((long)(now - (e.release + e.intervalMs)) > 0 && !e.late) {
+      e.late = true;
+      e.missed++;
+    }
+    overload |= e.late;
+  }
+
+  int best = -1;
+  for (int i = 0; i < WATCH_MAX_ENTRIES; i++) {
+    const WatchEntry& e = entries[i];
+    if (!e.active || e.bins == 0 || (long)(now - e.release) < 0) continue;
+    if (best < 0) {
+      best = i;
+      continue;
+    }
+
+    const WatchEntry& b = entries[best];
+    long slack = (long)(e.release + e.intervalMs - now);
+    long bestSlack = (long)(b.release + b.intervalMs - now);
+    bool better;
+    if (overload && e.priority != b.priority) {
+      better = e.priority > b.priority;
+    } else if (slack != bestSlack) {
+      better = slack < bestSlack;
+    } else {
+      better = e.priority > b.priority;
+    }
+    if (better) best = i;
+  }
+
+  // Nothing due: pull the next survey pass forward instead of idling
+  if (best < 0 && entries[WATCH_SURVEY].active && entries[WATCH_SURVEY].bins > 0) {
+    entries[WATCH_SURVEY].release = now;
+    best = WATCH_SURVEY;
+  }
+  return best;
+}
+
+int watchNextBin(int index) {
+  return entries[index].nextBin;
+}
+
+bool watchVisited(int index, unsigned long now) {
+  WatchEntry& e = entries[index];
+  if (++e.nextBin < e.bins) return false;
+
+  unsigned long deadline = e.release + e.intervalMs;
+  if ((long)(now - deadline) > 0) {
+    if (!e.late) e.missed++;
+    if (now - deadline > e.worstLateMs) e.worstLateMs = now - deadline;
+  }
+  if (e.passes > 0 && now - e.lastDone > e.worstRevisitMs) e.worstRevisitMs = now - e.lastDone;
+  e.lastDone = now;
+  e.passes++;
+
+  // Periodic release; a pass that is already a whole interval behind is dropped
+  unsigned long next = deadline;
+  if ((long)(now - (next + e.intervalMs)) >= 0) {
+    e.skipped += (now - next) / e.intervalMs;
+    next = now;
+  }
+  e.release = next;
+  e.nextBin = 0;
+  e.late = false;
+  return true;
+}
+
+const WatchEntry& watchEntry(int index) {
+  return entries[index];
+}
+
+float watchBinCenter(int index, int bin) {
+  const WatchEntry& e = entries[index];
+  return e.beginMHz + (bin + 0.5) * (e.endMHz - e.beginMHz) / e.bins;
+}
+
+float watchUtilization(unsigned long binMs) {
+  float total = 0.0;
+  for (int i = 0; i < WATCH_MAX_ENTRIES; i++) {
+    const WatchEntry& e = entries[i];
+    if (e.active && e.intervalMs > 0) total += (float)e.bins * binMs / e.intervalMs;
+  }
+  return total;
+}
@@ -0,0 +1,56 @@
+// Watch list: fine sweeps of registered segments interleaved with the coarse
+// full-span survey, scheduled earliest-deadline-first
+//
+// Every entry is a periodic job: one pass over its bins, released every
+// intervalMs and due one interval after its release. Jobs are preemptible
+// between bins, so a segment whose deadline comes up can cut into a long
+// survey pass. Entry 0 is the survey; it also takes any time no job is due,
+// so spare capacity goes to the overview. A job still unfinished at its
+// deadline counts as missed once. While any job is late the load does not
+// fit, and entries run in priority order, so the misses fall on the least
+// important ones.
+
+#pragma once
+
+#include <stdint.h>
+
+#ifndef WATCH_MAX_ENTRIES
+#define WATCH_MAX_ENTRIES 9        // Survey plus 8 segments
+#endif
+
+#define WATCH_MAX_BINS 64          // Bins per watched segment
+#define WATCH_SURVEY 0             // Entry index of the survey
+
+struct WatchEntry {
+  bool active;
+  float beginMHz;
+  float endMHz;
+  int bins;
+  unsigned long intervalMs;   // Target revisit interval, also the job's relative deadline
+  uint8_t priority;           // Higher goes first when jobs are late
+  // Current job
+  unsigned long release;      // millis() the job became (or becomes) due to run
+  int nextBin;                // Bins of the job already visited
+  bool late;                  // Missed deadline already counted
+  // Statistics since the entry was set
+  uint32_t passes;
+  uint32_t missed;
+  uint32_t skipped;           // Releases dropped after falling a whole interval behind
+  unsigned long worstLateMs;
+  unsigned long lastDone;     // millis() of the last completed pass
+  unsigned long worstRevisitMs;
+};
+
+void watchSetSurvey(float beginMHz, float endMHz, int bins, unsigned long intervalMs, unsigned long now);
+int watchAdd(float beginMHz, float endMHz, int bins, unsigned long intervalMs, uint8_t priority,
+             unsigned long now);               // Entry index, or -1 when the list is full
+bool watchRemove(int index);
+void watchClear();                             // Drops all segments, keeps the survey
+int watchSegments();
+
+int watchPick(unsigned long now);              // Entry whose bin goes next
+int watchNextBin(int index);
+bool watchVisited(int index, unsigned long now);  // True when the pass is complete
+const WatchEntry& watchEntry(int index);
+float watchBinCenter(int index, int bin);
+float watchUtilization(unsigned long binMs);   // Sum of pass time over interval
@@ -3,28 +3,16 @@
 #include <U8g2lib.h>
 #include <Wire.h>
 #include <SPI.h>
+#include <spectrum_core.h>
 
-// LoRa configuration (SX1262) - correct pins from pinout
-#define LORA_NSS 8
-#define LORA_SCK 9
-#define LORA_MOSI 10
-#define LORA_MISO 11
-#define LORA_RST 12
-#define LORA_BUSY 13
-#define LORA_DIO1 14
-
-// OLED pins from pinout
-#define OLED_SDA 17
-#define OLED_SCL 18
-#define OLED_RST 21
-#define VEXT_CTRL 36
-
-// Spectrum analyzer configuration
-#define FREQ_BEGIN 400.0    // Start frequency in MHz (extended range)
-#define FREQ_END 960.0      // End frequency in MHz (SX1262 limit)
-#define FREQ_STEPS 64       // Number of frequency steps (limited by display width)
-#define SAMPLES_PER_FREQ 128 // Number of samples per frequency step
-#define SCAN_DELAY 100      // Delay between frequency steps (ms)
+// Spectrum analyzer configuration: the shared default sweep, 400-960 MHz in
+// 64 bins (2 pixels per bin on the display)
+struct AnalyzerSweep : spectrum::SweepConfig {};
+using Sweep = spectrum::SweepTable<AnalyzerSweep>;
+#define FREQ_BEGIN AnalyzerSweep::BEGIN_MHZ
+#define FREQ_END AnalyzerSweep::END_MHZ
+#define FREQ_STEPS AnalyzerSweep::BINS
+#define SCAN_DELAY AnalyzerSweep::STEP_DELAY_MS
 
 // Different frequency bands for testing
 #define BAND_433 433.0      // 433 MHz ISM band
@@ -51,6 +39,7 @@ U8G2_SSD1306_128X64_NONAME_F_HW_I2C u8g2(U8G2_R0, /* reset=*/ OLED_RST);
 
 // RadioLib instance for SX1262
 SX1262 radio = new Module(LORA_NSS, LORA_DIO1, LORA_RST, LORA_BUSY);
+spectrum::SpectrumRadio spectrumRadio(radio);  // Shared sweep hot path
 
 // Spectrum analyzer variables
 float spectrumData[FREQ_STEPS];
@@ -72,6 +61,7 @@ void updateDisplay();
 void drawSpectrum();
 void drawAxes();
 float getRSSIAtFrequency(float frequency);
+float addTestSignals(float frequency, float avgRSSI);
 void monitorSingleFrequency();
 
 void setup() {
@@ -177,8 +167,7 @@ void loop() {
         // Set single frequency monitoring mode
         singleFreq = newFreq;
         singleFreqMode = true;
-        radio.setFrequency(newFreq);
-        radio.startReceive();
+        spectrumRadio.tune(newFreq);
         statusMessage = "Monitoring: " + String(newFreq, 1) + " MHz";
         Serial.println("Monitoring single frequency: " + String(newFreq, 1) + " MHz");
         Serial.println("Type 'scan' to return to full spectrum scanning");
@@ -186,43 +175,35 @@ void loop() {
         Serial.println("Frequency must be between 400-960 MHz");
       }
     } else if (command == "band868") {
-      radio.setFrequency(BAND_868);
-      radio.startReceive();
+      spectrumRadio.tune(BAND_868);
       statusMessage = "Band: 868 MHz";
       Serial.println("Set to 868 MHz band");
     } else if (command == "band915") {
-      radio.setFrequency(BAND_915);
-      radio.startReceive();
+      spectrumRadio.tune(BAND_915);
       statusMessage = "Band: 915 MHz";
       Serial.println("Set to 915 MHz band");
     } else if (command == "band433") {
-      radio.setFrequency(BAND_433);
-      radio.startReceive();
+      spectrumRadio.tune(BAND_433);
       statusMessage = "Band: 433 MHz";
       Serial.println("Set to 433 MHz band");
     } else if (command == "band470") {
-      radio.setFrequency(BAND_470);
-      radio.startReceive();
+      spectrumRadio.tune(BAND_470);
       statusMessage = "Band: 470 MHz";
       Serial.println("Set to 470 MHz band");
     } else if (command == "band800") {
-      radio.setFrequency(BAND_800);
-      radio.startReceive();
+      spectrumRadio.tune(BAND_800);
       statusMessage = "Band: 800 MHz";
       Serial.println("Set to 800 MHz band");
     } else if (command == "band900") {
-      radio.setFrequency(BAND_900);
-      radio.startReceive();
+      spectrumRadio.tune(BAND_900);
       statusMessage = "Band: 900 MHz";
       Serial.println("Set to 900 MHz band");
     } else if (command == "band435") {
-      radio.setFrequency(BAND_AMATEUR_70CM);
-      radio.startReceive();
+      spectrumRadio.tune(BAND_AMATEUR_70CM);
       statusMessage = "Band: 435 MHz";
       Serial.println("Set to 435 MHz amateur band");
     } else if (command == "band446") {
-      radio.setFrequency(BAND_PM446);
-      radio.startReceive();
+      spectrumRadio.tune(BAND_PM446);
       statusMessage = "Band: 446 MHz";
       Serial.println("Set to 446 MHz PMR band");
     } else if (command == "test") {
@@ -259,8 +240,8 @@ void loop() {
 }
 
 void initializeRadio() {
-  // Initialize LoRa (SX1262) in FSK mode for better spectrum analysis
-  int state = radio.beginFSK(FREQ_BEGIN);
+  // FSK mode with the sweep's RX bandwidth
+  int state = spectrumRadio.begin(FREQ_BEGIN, AnalyzerSweep::RX_BANDWIDTH_KHZ);
   if (state != RADIOLIB_ERR_NONE) {
     Serial.print("Radio initialization failed! Code: ");
     Serial.println(state);
@@ -268,22 +249,17 @@ void initializeRadio() {
     return;
   }
   
-  // Configure for spectrum analysis
-  radio.setRxBandwidth(250.0);  // 250 kHz bandwidth
-  radio.setDataShaping(RADIOLIB_SHAPING_NONE);
-  
-  // Start in receive mode
-  radio.startReceive();
-  
   Serial.println("Radio initialized for spectrum analysis");
 }
 
 void scanSpectrum() {
   // Only scan if scanning is enabled
   if (scanning) {
-    // Continuous scanning mode - scan one step at a time
-    float frequency = FREQ_BEGIN + (currentStep * (FREQ_END - FREQ_BEGIN) / FREQ_STEPS);
-    float rssi = getRSSIAtFrequency(frequency);
+    // Continuous scanning mode - scan one step at a time; tuning words come
+    // precomputed from the sweep table
+    float frequency = Sweep::bins[currentStep].freqMHz;
+    float rssi = spectrumRadio.measureBin<AnalyzerSweep>(currentStep);
+    rssi = addTestSignals(frequency, rssi);
     
     spectrumData[currentStep] = rssi;
     
@@ -305,36 +281,16 @@ void scanSpectrum() {
 }
 
 float getRSSIAtFrequency(float frequency) {
-  // Set radio to the specified frequency
-  radio.setFrequency(frequency);
-  radio.startReceive();
-  
-  // Wait for radio to settle
-  delay(10);
-  
-  // Read RSSI multiple times for better accuracy
-  float rssiSum = 0;
-  int validReadings = 0;
-  
-  for (int i = 0; i < 5; i++) {
-    float rssi = radio.getRSSI();
-    if (rssi > -200.0 && rssi < 0.0) { // Valid RSSI range
-      rssiSum += rssi;
-      validReadings++;
-    }
-    delay(2);
-  }
-  
+  // Tune, settle and average through the shared hot path
+  spectrumRadio.tune(frequency);
   float avgRSSI;
-  if (validReadings > 0) {
-    avgRSSI = rssiSum / validReadings;
-  } else {
-    // Generate realistic noise floor based on frequency
-    float noiseBase = -120.0; // Base noise floor
-    float freqVariation = (frequency - 600.0) / 100.0; // Add some frequency-based variation
-    avgRSSI = noiseBase + freqVariation + random(-10, 5); // -130 to -115 dBm range
+  if (!spectrumRadio.readRSSI(avgRSSI, AnalyzerSweep::SAMPLES, AnalyzerSweep::SETTLE_MS)) {
+    avgRSSI = spectrum::syntheticNoise(frequency);
   }
-  
+  return addTestSignals(frequency, avgRSSI);
+}
+
+float addTestSignals(float frequency, float avgRSSI) {
   // Test mode: add simulated signals
   if (testMode) {
     // Simulate a signal at the test frequency
@@ -9,6 +9,7 @@
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include <spectrum_core.h>
 
 // WiFi credentials
 const char* WIFI_SSID = "YOUR_WIFI_SSID";
@@ -17,36 +18,23 @@ const char* WIFI_PASSWORD = "YOUR_WIFI_PASSWORD";
 // API endpoint (your Vercel URL)
 const char* API_ENDPOINT = "https://your-app.vercel.app/api/spectrum";
 
-// LoRa configuration (SX1262)
-#define LORA_NSS 8
-#define LORA_SCK 9
-#define LORA_MOSI 10
-#define LORA_MISO 11
-#define LORA_RST 12
-#define LORA_BUSY 13
-#define LORA_DIO1 14
-
-// OLED pins
-#define OLED_SDA 17
-#define OLED_SCL 18
-#define OLED_RST 21
-#define VEXT_CTRL 36
-
-// Spectrum analyzer configuration
-#define FREQ_BEGIN 400.0
-#define FREQ_END 960.0
-#define FREQ_STEPS 64
-#define SCAN_DELAY 100
+// Spectrum analyzer configuration: the shared default sweep
+struct WifiSweep : spectrum::SweepConfig {};
+using Sweep = spectrum::SweepTable<WifiSweep>;
 
 // Initialize hardware
 U8G2_SSD1306_128X64_NONAME_F_HW_I2C u8g2(U8G2_R0, OLED_RST);
 SX1262 radio = new Module(LORA_NSS, LORA_DIO1, LORA_RST, LORA_BUSY);
+spectrum::SpectrumRadio spectrumRadio(radio);
 
 // Data storage
-float spectrumData[FREQ_STEPS];
+float spectrumData[WifiSweep::BINS];
 bool scanning = true;
 int currentStep = 0;
 unsigned long lastSendTime = 0;
+unsigned long sweepStartTime = 0;
+unsigned long sweepEndTime = 0;
+unsigned long sweepSeq = 0;
 const unsigned long SEND_INTERVAL = 1000; // Send every 1 second
 
 void connectWiFi() {
@@ -84,15 +72,18 @@ void sendDataToAPI() {
   StaticJsonDocument<2048> doc;
   doc["timestamp"] = millis();
   doc["deviceId"] = WiFi.macAddress();
-  doc["freqBegin"] = FREQ_BEGIN;
-  doc["freqEnd"] = FREQ_END;
-  doc["freqSteps"] = FREQ_STEPS;
+  doc["seq"] = ++sweepSeq;
+  doc["sweepStart"] = sweepStartTime;
+  doc["sweepEnd"] = sweepEndTime;
+  doc["freqBegin"] = WifiSweep::BEGIN_MHZ;
+  doc["freqEnd"] = WifiSweep::END_MHZ;
+  doc["freqSteps"] = WifiSweep::BINS;
+  doc["rxBandwidth"] = WifiSweep::RX_BANDWIDTH_KHZ;
   
   JsonArray data = doc.createNestedArray("data");
-  for (int i = 0; i < FREQ_STEPS; i++) {
+  for (int i = 0; i < WifiSweep::BINS; i++) {
     JsonObject point = data.createNestedObject();
-    float freq = FREQ_BEGIN + (i * (FREQ_END - FREQ_BEGIN) / FREQ_STEPS);
-    point["freq"] = freq;
+    point["freq"] = Sweep::bins[i].freqMHz;
     point["rssi"] = spectrumData[i];
   }
   
@@ -111,55 +102,25 @@ void sendDataToAPI() {
 }
 
 void initializeRadio() {
-  int state = radio.beginFSK(FREQ_BEGIN);
+  int state = spectrumRadio.begin(WifiSweep::BEGIN_MHZ, WifiSweep::RX_BANDWIDTH_KHZ);
   if (state != RADIOLIB_ERR_NONE) {
-    Serial.println("Radio init failed!");
+    Serial.printf("Radio init failed! Code: %d\n", state);
     return;
   }
-  radio.setRxBandwidth(250.0);
-  radio.setDataShaping(RADIOLIB_SHAPING_NONE);
-  radio.startReceive();
   Serial.println("Radio initialized");
 }
 
-float getRSSIAtFrequency(float frequency) {
-  radio.setFrequency(frequency);
-  radio.startReceive();
-  delay(10);
-  
-  float rssiSum = 0;
-  int validReadings = 0;
-  
-  for (int i = 0; i < 5; i++) {
-    float rssi = radio.getRSSI();
-    if (rssi > -200.0 && rssi < 0.0) {
-      rssiSum += rssi;
-      validReadings++;
-    }
-    delay(2);
-  }
-  
-  float avgRSSI;
-  if (validReadings > 0) {
-    avgRSSI = rssiSum / validReadings;
-  } else {
-    float noiseBase = -120.0;
-    float freqVariation = (frequency - 600.0) / 100.0;
-    avgRSSI = noiseBase + freqVariation + random(-10, 5);
-  }
-  
-  return avgRSSI;
-}
-
 void scanSpectrum() {
   if (scanning) {
-    float frequency = FREQ_BEGIN + (currentStep * (FREQ_END - FREQ_BEGIN) / FREQ_STEPS);
-    float rssi = getRSSIAtFrequency(frequency);
-    spectrumData[currentStep] = rssi;
+    if (currentStep == 0) {
+      sweepStartTime = millis();
+    }
+    spectrumData[currentStep] = spectrumRadio.measureBin<WifiSweep>(currentStep);
     
     currentStep++;
-    if (currentStep >= FREQ_STEPS) {
+    if (currentStep >= WifiSweep::BINS) {
       currentStep = 0;
+      sweepEndTime = millis();
       // Full scan complete, send data
       if (millis() - lastSendTime > SEND_INTERVAL) {
         sendDataToAPI();
@@ -198,7 +159,7 @@ void setup() {
   initializeRadio();
   
   // Initialize spectrum data
-  for (int i = 0; i < FREQ_STEPS; i++) {
+  for (int i = 0; i < WifiSweep::BINS; i++) {
     spectrumData[i] = -100.0;
   }
   
@@ -212,6 +173,6 @@ void setup() {
 
 void loop() {
   scanSpectrum();
-  delay(SCAN_DELAY);
+  delay(WifiSweep::STEP_DELAY_MS);
 }
 
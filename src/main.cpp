@@ -4,28 +4,45 @@
 #include <ArduinoJson.h>
 #include <Wire.h>
 #include <SPI.h>
-
-// LoRa configuration (SX1262) - correct pins from pinout
-#define LORA_NSS 8
-#define LORA_SCK 9
-#define LORA_MOSI 10
-#define LORA_MISO 11
-#define LORA_RST 12
-#define LORA_BUSY 13
-#define LORA_DIO1 14
-
-// OLED pins from pinout
-#define OLED_SDA 17
-#define OLED_SCL 18
-#define OLED_RST 21
-#define VEXT_CTRL 36
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <driver/uart.h>
+#include <Preferences.h>
+#include <LittleFS.h>
+#include <spectrum_core.h>
+#include <spectrum_log.h>
+#include <spectrum_occupancy.h>
+#include <spectrum_baseline.h>
+#include <spectrum_replay.h>
+#include <spectrum_capture.h>
+#include <spectrum_watch.h>
+#include <mbedtls/base64.h>
 
 // Spectrum analyzer configuration
 #define FREQ_BEGIN 400.0    // Start frequency in MHz (extended range)
 #define FREQ_END 960.0      // End frequency in MHz (SX1262 limit)
-#define FREQ_STEPS 64       // Number of frequency steps (limited by display width)
-#define SAMPLES_PER_FREQ 64 // Number of samples per frequency step (reduced for speed)
+#define FREQ_STEPS 64       // Default number of sweep bins (runtime: 'bins <n>')
+#define MAX_FREQ_STEPS 1024 // Storage limit for high-resolution sweeps
+#define MIN_FREQ_STEPS 16   // Smallest sweep accepted by 'bins <n>'
 #define SCAN_DELAY 10       // Delay between frequency steps (ms) for faster updates
+#define RSSI_SAMPLES 16     // RSSI readings averaged per step (one SPI burst, well under 1 ms)
+#define SETTLE_DELAY 10     // Time to let the PLL settle after retuning (ms)
+#define RX_BANDWIDTH 234.3  // Default receiver bandwidth (kHz), must be a valid SX1262 FSK value
+
+// Adaptive sweep configuration
+#define ADAPTIVE_ACTIVE_MARGIN 6.0  // dB above a bin's noise floor counted as activity
+#define ADAPTIVE_QUIET_VISITS 8     // Consecutive quiet visits before a bin is idle
+#define ADAPTIVE_FLOOR_VISITS 4     // An untrained bin's floor is the minimum of its first readings
+#define ADAPTIVE_FLOOR_GAIN 8.0     // Quiet readings move the floor by 1/8 of the difference
+#define ADAPTIVE_FLOOR_RISE 512.0   // Active readings pull it up by 1/512, for a background that rose
+#define ADAPTIVE_HOLD_MS 3000       // How long a bin stays hot after activity (ms)
+#define ADAPTIVE_NEIGHBOR_BINS 1    // Bins on each side of activity that also run hot
+#define ADAPTIVE_HOT_SAMPLES 64     // RSSI readings per visit for hot bins
+#define ADAPTIVE_IDLE_SAMPLES 4     // RSSI readings per visit for idle bins
+#define ADAPTIVE_IDLE_SETTLE 3      // Shorter settle time for idle bins (ms)
+#define ADAPTIVE_HOT_REVISIT_MS 100 // Target revisit interval for hot bins (ms)
+#define ADAPTIVE_REVISIT_MS 500     // Target revisit interval for normal bins (ms)
+#define ADAPTIVE_MAX_REVISIT_MS 2000 // Fairness bound: no bin waits longer than this (ms)
 
 // Different frequency bands for testing
 #define BAND_433 433.0      // 433 MHz ISM band
@@ -40,126 +57,623 @@
 #define BAND_CB_27 27.0          // CB radio (out of range)
 #define BAND_PM446 446.0         // PMR446 walkie-talkies
 
+// Low-power survey configuration (currents are board-level estimates for sizing)
+#define SURVEY_SUPPLY_VOLTAGE 3.7  // Nominal battery voltage (V)
+#define SURVEY_AWAKE_MA 95.0       // CPU active, SX1262 in RX, OLED off (mA)
+#define SURVEY_SLEEP_MA 2.0        // Light sleep, SX1262 warm sleep, OLED off (mA)
+#define SURVEY_WAKE_WINDOW_MS 5000 // Stay awake this long after serial input (ms)
+
+// Channel occupancy
+#define OCC_THRESHOLD -95.0         // Default busy threshold (dBm), runtime: 'occ <dBm>'
+#define OCC_TOP_BINS 5              // Busiest bins listed per window by 'occ'
+#define OCC_JSON_BINS 128           // Bins per occupancy JSON line; reports go out in fixed-size chunks
+#define OCC_JSON_LINE 3072          // Serialized chunk: 128 x ("100.0," + bursts) plus fields
+
+// Learned noise-floor baseline
+#define BASELINE_SAVE_INTERVAL 900000UL  // Min time between NVS writes (ms), limits flash wear
+#define BASELINE_SCALE_SPREADS 3.0  // Initial display range: floor +/- this many spreads
+
+// Replay of recorded sweeps
+#define REPLAY_BATCH_MS 50          // Fast replay: time spent sweeping per loop() pass (ms)
+#define REPLAY_PRINT_MS 1000        // Fast file replay: one snapshot printed per interval (ms)
+
+// Triggered capture
+#define TRIGGER_PRE_SWEEPS 4        // Sweeps kept from before the trigger, runtime: 'capture'
+#define TRIGGER_POST_SWEEPS 4       // Sweeps captured from the trigger on, including its own
+#define CAPTURE_DWELL_MAX 4096      // Fixed-frequency samples one capture can hold
+#define CAPTURE_DWELL_BATCH_MS 50   // Dwell sampling per loop() pass, so commands still get through
+
+// Watch list: segments swept on their own deadlines between survey bins
+#define WATCH_SURVEY_MS 10000       // Survey revisit target while segments are watched (ms), runtime: 'watch survey <s>'
+#define WATCH_MIN_INTERVAL_MS 50    // Shortest revisit interval accepted for a segment (ms)
+#define WATCH_MIN_BINS 4            // Smallest fine sweep of a segment
+#define WATCH_PRIORITY 1            // Default segment priority; the survey is 0
+
+// Boot
+#define SERIAL_WAIT_MS 200          // Max wait for a USB host; headless units start scanning anyway
+#define BOOT_CONFIG_VERSION 1       // Bump when BootConfig changes layout
+
+// High-rate single-frequency RSSI streaming
+#define STREAM_RING_SIZE 4096       // Samples buffered for output (power of two)
+#define STREAM_BLOCK_SAMPLES 128    // Samples per emitted block
+#define STREAM_BURST_MARGIN 10.0    // dB above the noise floor that starts a burst
+#define STREAM_BURST_HYSTERESIS 3.0 // dB below the start level that ends a burst
+#define STREAM_STATS_MS 1000        // Statistics report interval (ms)
+#define STREAM_YIELD_MS 20          // Sampler sleeps one tick this often so core 0's other tasks run
+#define SERIAL_TX_BUFFER 2048       // UART TX buffer so blocks and logs don't stall
+
+// Fixed-cadence sweep ('cadence <ms>'): a hardware timer paces one slot per bin
+#define CADENCE_TIMER 0             // Hardware timer used for the bin slots
+#define CADENCE_MARGIN_US 500       // Slot time kept free beyond settle and sampling (us)
+#define CADENCE_OVERRUN_LOG 16      // Most recent overruns kept with timestamps
+
 // Display configuration
 #define DISPLAY_WIDTH 128
 #define DISPLAY_HEIGHT 64
 #define GRAPH_HEIGHT 40
 #define GRAPH_Y_OFFSET 10
 #define GRAPH_X_OFFSET 0
+#define DISPLAY_COLUMNS 64  // Spectrum columns on the OLED (64 or 128)
+#define COLUMN_WIDTH (DISPLAY_WIDTH / DISPLAY_COLUMNS)
+#define STATUS_MAX 32       // Status line buffer, longer messages are cut
+#define LABEL_MAX 20        // Axis and range label buffer
 
 // Initialize the OLED display
 U8G2_SSD1306_128X64_NONAME_F_HW_I2C u8g2(U8G2_R0, /* reset=*/ OLED_RST);
 
 // RadioLib instance for SX1262
 SX1262 radio = new Module(LORA_NSS, LORA_DIO1, LORA_RST, LORA_BUSY);
+spectrum::SpectrumRadio spectrumRadio(radio);  // Shared sweep hot path
 
 // Spectrum analyzer variables
-float spectrumData[FREQ_STEPS];
+float spectrumData[MAX_FREQ_STEPS];
+int freqSteps = FREQ_STEPS;   // Active number of sweep bins
+float sweepBegin = FREQ_BEGIN; // Active sweep span (MHz), set by 'plan'
+float sweepEnd = FREQ_END;
+float rxBandwidth = RX_BANDWIDTH; // Active receiver bandwidth (kHz)
+unsigned long sweepStartTime = 0;    // millis() when the current sweep started
+unsigned long lastSweepDuration = 0; // Measured duration of the last full sweep (ms)
+unsigned long sweepSeq = 0;          // Sequence number of the last emitted sweep
+bool occupancyReportPending = false; // Print occupancy after the next snapshot
+uint32_t occupancyReports = 0;       // Report number, ties a report's chunk lines together
+unsigned long lastBaselineSave = 0;  // millis() of the last baseline NVS write
+unsigned long setupDoneMs = 0;       // millis() when setup() returned
+unsigned long firstSweepMs = 0;      // millis() when the first sweep was emitted
+volatile bool displayReady = false;  // Set by the display init task
+
+// Replay feeds recorded sweeps through scanSpectrum() in place of the radio
+enum ReplayMode { REPLAY_OFF, REPLAY_REALTIME, REPLAY_FAST };
+ReplayMode replayMode = REPLAY_OFF;
+SweepReplay replay;
+File replayFile;
+StreamReplayInput replayInput(replayFile);  // Follows replayFile across reopens
+bool replayFromSerial = false;       // Sweeps arrive as JSON lines on the command port
+bool replayPending = false;          // Serial sweep received, not yet loaded for scanning
+bool replayLoaded = false;           // Current recorded sweep waits to be scanned
+unsigned long replayStartMs = 0;     // millis() when replay started
+unsigned long replayClockStart = 0;  // millis() matching replayFirstTimestamp
+uint32_t replayFirstTimestamp = 0;   // Recorded timestamp that real-time pacing counts from
+unsigned long replaySweeps = 0;      // Sweeps completed during this replay
+unsigned long replayLastPrint = 0;
+float replaySavedBegin = FREQ_BEGIN; // Plan to restore when replay ends
+float replaySavedEnd = FREQ_END;
+int replaySavedBins = FREQ_STEPS;
+bool replaySavedAdaptive = false;
+
+// Sweep plan and radio settings restored at boot, so a power cycle resumes
+// where the unit left off
+struct BootConfig {
+  uint16_t version;
+  uint16_t bins;
+  float begin;         // MHz
+  float end;           // MHz
+  float rxBandwidth;   // kHz
+  uint8_t adaptive;
+  uint8_t reserved[3]; // Explicit, zeroed padding so the stored bytes compare equal
+};
+static_assert(sizeof(BootConfig) == 20, "BootConfig must have no implicit padding; it is compared with memcmp");
+
+// SX1262 FSK receiver bandwidths (kHz), narrowest first
+const float RX_BANDWIDTHS[] = {
+  4.8, 5.8, 7.3, 9.7, 11.7, 14.6, 19.5, 23.4, 29.3, 39.0, 46.9,
+  58.6, 78.2, 93.8, 117.3, 156.2, 187.2, 234.3, 312.0, 373.6, 467.0
+};
+const int RX_BANDWIDTH_COUNT = sizeof(RX_BANDWIDTHS) / sizeof(RX_BANDWIDTHS[0]);
+
+// Result of the coverage planner
+struct SweepPlan {
+  float begin;            // MHz
+  float end;              // MHz
+  float rxBandwidth;      // kHz
+  int bins;
+  float coverage;         // Fraction of the span inside some bin's RX bandwidth
+  unsigned long sweepMs;  // Estimated time for one full sweep
+};
 float maxRSSI = -200.0;
 float minRSSI = 0.0;
 bool scanning = true;  // Start scanning by default
 unsigned long lastScanTime = 0;
 int currentStep = 0;
-String statusMessage = "Initializing...";
+char statusMessage[STATUS_MAX] = "Initializing...";  // Bottom line of the display, see setStatus()
 bool testMode = false;
 float testSignalFreq = 0.0;
 bool singleFreqMode = false;  // Single frequency monitoring mode
 float singleFreq = 915.0;     // Default single frequency
+bool adaptiveMode = false;    // Adaptive dwell sweep instead of fixed round-robin
+
+// Per-bin state for the adaptive sweep
+float binNoiseFloor[MAX_FREQ_STEPS];         // Running noise floor estimate per bin, NAN until measured
+uint8_t binFloorVisits[MAX_FREQ_STEPS];      // Readings in the floor so far, up to ADAPTIVE_FLOOR_VISITS
+unsigned long binLastVisit[MAX_FREQ_STEPS];  // millis() of the last visit
+unsigned long binLastActive[MAX_FREQ_STEPS]; // millis() of the last reading above the floor
+uint8_t binQuietCount[MAX_FREQ_STEPS];       // Consecutive quiet visits (saturates)
+uint16_t binVisits[MAX_FREQ_STEPS];          // Visits since the last snapshot
+unsigned long adaptiveVisitCount = 0;    // Total adaptive visits, drives snapshots
+unsigned long adaptiveSnapshotTime = 0;  // millis() of the last adaptive snapshot
+
+// Scheduled low-power survey
+bool surveyMode = false;
+unsigned long surveyInterval = 60000;  // Time between survey sweeps (ms)
+unsigned long nextSurveyTime = 0;      // millis() of the next scheduled sweep
+unsigned long surveyAwakeUntil = 0;    // Serial wake window end (millis())
+unsigned long surveyCount = 0;
+unsigned long lastSurveyAwakeMs = 0;   // Measured awake time of the last sweep
+float lastSurveyEnergy = 0.0;          // Estimated energy per sweep cycle (mJ)
+
+// Fixed-frequency streaming: a sampler task on core 0 fills the ring, loop() emits blocks
+struct RssiSample {
+  uint32_t us;     // micros() when the sample was read
+  int16_t rssiQ;   // RSSI in 0.5 dB steps
+};
+
+struct BurstStats {
+  uint32_t samples;
+  uint32_t bursts;
+  uint32_t closedBursts;      // Bursts that have ended; busyUs covers only these
+  uint64_t busyUs;            // Total time inside ended bursts
+  uint32_t minBurstUs;
+  uint32_t maxBurstUs;
+  uint64_t interArrivalSumUs; // Sum of start-to-start intervals
+  uint32_t minInterArrivalUs;
+  uint32_t maxInterArrivalUs;
+  uint32_t startUs;           // micros() of the first sample
+  uint32_t lastUs;            // micros() of the latest sample
+  float noiseFloor;
+  float lastRSSI;
+};
+
+bool streamMode = false;
+volatile bool streamRunning = false;
+float streamFreq = 915.0;
+RssiSample streamRing[STREAM_RING_SIZE];
+volatile uint32_t streamHead = 0;       // Written by the sampler task
+volatile uint32_t streamTail = 0;       // Advanced by loop()
+volatile uint32_t streamOverflows = 0;  // Samples lost because output fell behind
+uint32_t streamBlocks = 0;
+BurstStats streamStats;
+portMUX_TYPE streamLock = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t streamTaskHandle = NULL;
+unsigned long lastStreamReport = 0;
+uint32_t lastReportSamples = 0;
+
+// Fixed-cadence sweep: the timer ISR starts one slot per bin, a task on core 0
+// reads the bin in its slot, and loop() takes finished sweeps from the hand-off
+// buffer and does display, serial and statistics in the slack
+enum CadenceOverrunKind { OVERRUN_BIN_LATE, OVERRUN_BIN_MISSED, OVERRUN_SWEEP_LATE };
+struct CadenceOverrun {
+  unsigned long ms;  // millis() when detected
+  uint32_t sweep;    // Sweep number since the cadence started
+  int16_t bin;
+  uint8_t kind;
+  uint32_t lateUs;   // Past the end of the bin's slot
+};
+bool cadenceMode = false;
+volatile bool cadenceRunning = false;
+unsigned long cadenceRequestMs = 0;     // Period asked for; the real one is whole microseconds per bin
+uint32_t cadenceSlotUs = 0;
+uint32_t cadencePeriodUs = 0;           // cadenceSlotUs * cadenceBins
+int cadenceBins = 0;
+hw_timer_t* cadenceTimer = NULL;
+TaskHandle_t cadenceTaskHandle = NULL;
+volatile uint32_t cadenceTicks = 0;     // Slots started by the timer
+volatile int64_t cadenceStartUs = 0;    // esp_timer time of the first slot
+float cadenceWork[MAX_FREQ_STEPS];      // Sweep being read, task only
+float cadenceDone[MAX_FREQ_STEPS];      // Last complete sweep, under cadenceLock
+float cadenceSweep[MAX_FREQ_STEPS];     // loop()'s copy of it
+bool cadenceWorkMeasured[MAX_FREQ_STEPS];   // Per bin of each: false for a fallback or missed reading
+bool cadenceDoneMeasured[MAX_FREQ_STEPS];
+bool cadenceSweepMeasured[MAX_FREQ_STEPS];
+bool cadenceDoneReady = false;
+uint32_t cadenceDoneSweep = 0;
+uint16_t cadenceDoneOverruns = 0;       // Late or missed bins in that sweep
+uint16_t cadenceLastOverruns = 0;       // Same, for the sweep loop() is emitting
+uint32_t cadenceSweeps = 0;
+uint32_t cadenceBinsLate = 0;
+uint32_t cadenceBinsMissed = 0;
+uint32_t cadenceSweepsLate = 0;         // Sweeps replaced before loop() took them
+CadenceOverrun cadenceOverruns[CADENCE_OVERRUN_LOG];
+uint32_t cadenceOverrunCount = 0;
+uint32_t cadenceOverrunsReported = 0;
+portMUX_TYPE cadenceLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Triggered capture: while armed, sweeps only leave the device as the window
+// around a trigger, followed by post-trigger sweeps or fixed-frequency samples
+enum CaptureState { CAPTURE_OFF, CAPTURE_ARMED, CAPTURE_POST, CAPTURE_DWELL };
+CaptureState captureState = CAPTURE_OFF;
+int capturePre = TRIGGER_PRE_SWEEPS;
+int capturePost = TRIGGER_POST_SWEEPS;
+int captureDwellSamples = 0;         // Samples at the trigger frequency instead of post sweeps
+int capturePostLeft = 0;             // Post-trigger sweeps still to store
+unsigned long captureId = 0;         // Captures since boot
+unsigned long captureTriggerMs = 0;  // millis() when the trigger fired
+float captureTriggerFreq = 0.0;      // Bin centre (MHz) that fired
+float captureTriggerRSSI = 0.0;
+RssiSample captureSamples[CAPTURE_DWELL_MAX];
+int captureSampleCount = 0;
+
+// Watch list presets over the band constants, for 'watch band<n>'
+struct WatchPreset {
+  const char* name;
+  float begin;              // MHz
+  float end;                // MHz
+  unsigned long intervalMs; // Default revisit target
+  uint8_t priority;
+};
+const WatchPreset WATCH_PRESETS[] = {
+  {"band433", BAND_433, BAND_433 + 2.0, 2000, 2},          // 433-435 MHz ISM / LPD433
+  {"band446", BAND_PM446, BAND_PM446 + 0.2, 500, 3},       // PMR446 voice channels
+  {"band868", BAND_868 - 5.0, BAND_868 + 2.0, 3000, 2},    // 863-870 MHz EU SRD
+  {"band915", BAND_915 - 13.0, BAND_915 + 13.0, 5000, 1},  // 902-928 MHz US ISM
+};
+const int WATCH_PRESET_COUNT = sizeof(WATCH_PRESETS) / sizeof(WATCH_PRESETS[0]);
+unsigned long watchSurveyMs = WATCH_SURVEY_MS;
+float watchData[WATCH_MAX_ENTRIES][WATCH_MAX_BINS];  // Last pass of each segment (dBm)
+unsigned long watchPassStart[WATCH_MAX_ENTRIES];     // millis() when the running pass started
+
+// Display labels are formatted into fixed buffers, and only when the values
+// they show change, so drawing a frame never touches the heap
+struct DisplayLabel {
+  char text[LABEL_MAX];
+  int a, b;    // Values currently in text
+  int width;   // Pixel width in the label's font, for right alignment
+  bool valid;
+};
+DisplayLabel labelStart, labelEnd, labelRange, labelMax, labelMin;
+
+// Heap allocations made on loop()'s task; only HEAP_COUNT_ALLOCS builds count
+// them (see the heapcount environment in platformio.ini), otherwise they stay 0
+TaskHandle_t heapCountTask = NULL;
+volatile uint32_t heapAllocs = 0;  // Since boot
+uint32_t loopAllocsStart = 0;      // heapAllocs when the current pass began
+uint32_t loopAllocsLast = 0;       // During the previous loop() pass
+uint32_t loopAllocsMax = 0;
+uint32_t renderAllocs = 0;         // Inside updateDisplay(), since boot
+unsigned long loopPasses = 0;
+
+// Display decimation: each OLED column shows the min/max of the bins it covers
+int zoomFirst = 0;                 // First sweep bin shown on the display
+int zoomCount = FREQ_STEPS;        // Number of sweep bins shown on the display
+float columnMin[DISPLAY_COLUMNS];
+float columnMax[DISPLAY_COLUMNS];
 
 // Function declarations
 void initializeRadio();
 void scanSpectrum();
 void updateDisplay();
+void setStatus(const char* format, ...) __attribute__((format(printf, 1, 2)));
+bool updateLabel(DisplayLabel& label, int a, int b, const char* format);
+void printHeapInfo();
 void drawSpectrum();
 void drawAxes();
-float getRSSIAtFrequency(float frequency);
+float getRSSIAtFrequency(float frequency, int samples = RSSI_SAMPLES, int settleMs = SETTLE_DELAY,
+                         bool* measured = NULL);
 void monitorSingleFrequency();
+void startStream(float frequency);
+void stopStream();
+void streamTask(void* param);
+void streamOutput();
+void printStreamStats(const BurstStats& stats);
+bool startCadence(unsigned long periodMs);
+void stopCadence();
+bool cadenceKeepsRunning(const String& command);
+void IRAM_ATTR onCadenceTimer();
+void cadenceTask(void* param);
+void cadenceSlotDone(uint32_t slot, uint16_t& sweepOverruns);
+void recordCadenceOverrun(CadenceOverrunKind kind, uint32_t slot, uint32_t lateUs);
+void cadenceOutput();
+void printCadenceInfo();
 void printJsonSnapshot();
+void printSweepJson(const CapturedSweep* row, int index);
+bool armCapture();
+void disarmCapture();
+void fireTrigger(int bin, float rssi);
+void captureSweepDone();
+void captureDwell();
+void emitCapture();
+void printCaptureSamples();
+void printCaptureInfo();
+void recordBinVisit(int bin, float rssi, bool measured = true);
+void scanWatch();
+void addWatch(float beginMHz, float endMHz, unsigned long intervalMs, uint8_t priority);
+void printWatchJson(int entry);
+void printWatchList();
+void resetSpectrumData();
+void maybeSaveBaseline();
+void printBaselineInfo();
+void startReplay(const String& source, bool fast);
+void stopReplay();
+void replayCycle();
+bool advanceReplay();
+float replayRSSI(float mhz);
+bool loadBootConfig();
+void saveBootConfig();
+void displayInitTask(void* param);
+void printOccupancyReport();
+void printOccupancyJson();
+void resetAdaptiveState();
+void scanAdaptive();
+int pickAdaptiveBin(unsigned long now);
+bool isBinHot(int bin, unsigned long now);
+float binFrequency(int bin);
+float binCenterFrequency(int bin);
+unsigned long estimatedBinTime();
+float coverageFraction(float beginMHz, float endMHz, int bins, float bwKHz);
+SweepPlan planSweep(float beginMHz, float endMHz, unsigned long targetMs);
+void applySweepPlan(const SweepPlan& plan);
+void printSweepPlan(const SweepPlan& plan);
+void startSurvey(unsigned long intervalMs);
+void stopSurvey();
+void surveyCycle();
+void runSurveySweep();
+void setBin(int bin, float rssi);
+void setSweepBins(int bins);
+void setZoom(float beginMHz, float endMHz);
+void recomputeColumn(int column);
+void recomputeAllColumns();
+int columnFirstBin(int column);
+int columnEndBin(int column);
+
+#ifdef HEAP_COUNT_ALLOCS
+// Linked with -Wl,--wrap for each of these, so every allocator call in the
+// image lands here first; only calls from loop()'s task are counted
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  if (xTaskGetCurrentTaskHandle() == heapCountTask) heapAllocs++;
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  if (xTaskGetCurrentTaskHandle() == heapCountTask) heapAllocs++;
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  if (xTaskGetCurrentTaskHandle() == heapCountTask) heapAllocs++;
+  return __real_realloc(ptr, size);
+}
+}
+#endif
 
 void setup() {
   // Initialize Serial Monitor
+  Serial.setTxBufferSize(SERIAL_TX_BUFFER);
   Serial.begin(115200);
-  while (!Serial) {
+  // Wait briefly for a USB host, but never block a unit running without one
+  unsigned long serialWaitStart = millis();
+  while (!Serial && millis() - serialWaitStart < SERIAL_WAIT_MS) {
     delay(10);
   }
   
   Serial.println("Heltec LoRa Spectrum Analyzer");
   Serial.println("=============================");
 
+  // Diagnostics go through the log ring buffer so the sweep never blocks on them
+  logBegin(LOG_LEVEL_DEBUG);
+
   // Enable Vext power for OLED (active LOW on Heltec V3)
   pinMode(VEXT_CTRL, OUTPUT);
   digitalWrite(VEXT_CTRL, LOW);
-  delay(10);
 
-  // Initialize I2C for OLED
-  Wire.begin(OLED_SDA, OLED_SCL);
-  
-  // Initialize OLED display
-  u8g2.begin();
-  u8g2.clearBuffer();
-  u8g2.setFont(u8g2_font_ncenB08_tr);
-  u8g2.drawStr(0, 10, "Spectrum Analyzer");
-  u8g2.drawStr(0, 25, "Initializing...");
-  u8g2.sendBuffer();
+  // Last sweep plan from NVS, before anything that depends on it
+  if (loadBootConfig()) {
+    LOG_INFO("Restored plan: %.2f - %.2f MHz, %d bins, %.1f kHz RX bandwidth",
+             sweepBegin, sweepEnd, freqSteps, rxBandwidth);
+  }
+  zoomFirst = 0;
+  zoomCount = freqSteps;
 
   // Initialize SPI for SX1262
   SPI.begin(LORA_SCK, LORA_MISO, LORA_MOSI, LORA_NSS);
+
+  // OLED init (I2C) runs on core 0 while this core brings up the radio (SPI)
+  xTaskCreatePinnedToCore(displayInitTask, "displayInit", 4096, NULL, 1, NULL, 0);
   
-  // Initialize spectrum data array
-  for (int i = 0; i < FREQ_STEPS; i++) {
-    spectrumData[i] = -100.0;
+  // Restore the noise floor learned for this sweep plan, so scaling and
+  // thresholds are right from the first sweep
+  if (baselineSelect(sweepBegin, sweepEnd, freqSteps, rxBandwidth)) {
+    LOG_INFO("Baseline restored: %d of %d bins", baselineTrainedBins(), freqSteps);
   }
+  resetSpectrumData();
+  resetAdaptiveState();
+  recomputeAllColumns();
+  occupancyReset(freqSteps, OCC_THRESHOLD, millis());
   
   // Initialize radio for spectrum analysis
   initializeRadio();
+
+  // loop() draws from the start, so the display has to be up before returning
+  while (!displayReady) {
+    delay(1);
+  }
   
   Serial.println("Spectrum Analyzer Ready!");
   Serial.println("Type 'help' for available commands");
-  Serial.println("Frequency range: " + String(FREQ_BEGIN, 1) + " - " + String(FREQ_END, 1) + " MHz");
+  Serial.println("Frequency range: " + String(sweepBegin, 1) + " - " + String(sweepEnd, 1) + " MHz");
   Serial.println("Available bands: 433, 435, 446, 470, 800, 868, 900, 915 MHz");
   Serial.println("Try: 'test' for simulated signals, or scan real bands like 433/446 MHz");
-  statusMessage = "Scanning...";
+  setStatus(adaptiveMode ? "Adaptive scan" : "Scanning...");
+  setupDoneMs = millis();
+  LOG_INFO("Setup done in %lu ms", setupDoneMs);
+  heapCountTask = xTaskGetCurrentTaskHandle();  // setup() and loop() share a task
 }
 
-void loop() {
-  // Update display continuously
-  updateDisplay();
+void displayInitTask(void* param) {
+  delay(10);  // Vext settle; only this task waits for it
+
+  // Initialize I2C for OLED
+  Wire.begin(OLED_SDA, OLED_SCL);
   
-  // Scan spectrum or monitor single frequency
-  if (millis() - lastScanTime > SCAN_DELAY && scanning) {
-    if (singleFreqMode) {
-      monitorSingleFrequency();
-    } else {
-      scanSpectrum();
+  // Initialize OLED display
+  u8g2.begin();
+  u8g2.clearBuffer();
+  u8g2.setFont(u8g2_font_ncenB08_tr);
+  u8g2.drawStr(0, 10, "Spectrum Analyzer");
+  u8g2.drawStr(0, 25, "Initializing...");
+  u8g2.sendBuffer();
+
+  displayReady = true;
+  vTaskDelete(NULL);
+}
+
+bool loadBootConfig() {
+  Preferences prefs;
+  BootConfig config;
+  if (!prefs.begin("boot", true)) return false;
+  bool ok = prefs.getBytes("config", &config, sizeof(config)) == sizeof(config);
+  prefs.end();
+  if (!ok || config.version != BOOT_CONFIG_VERSION) return false;
+
+  // Only accept settings the radio and the sweep code can actually use
+  bool validBandwidth = false;
+  for (int i = 0; i < RX_BANDWIDTH_COUNT; i++) {
+    if (RX_BANDWIDTHS[i] == config.rxBandwidth) validBandwidth = true;
+  }
+  if (!validBandwidth || config.bins < MIN_FREQ_STEPS || config.bins > MAX_FREQ_STEPS ||
+      config.begin < 150.0 || config.end > 960.0 || config.begin >= config.end) {
+    return false;
+  }
+
+  sweepBegin = config.begin;
+  sweepEnd = config.end;
+  freqSteps = config.bins;
+  rxBandwidth = config.rxBandwidth;
+  adaptiveMode = config.adaptive != 0;
+  return true;
+}
+
+// Called on every plan or mode change; skips the flash write if nothing changed
+void saveBootConfig() {
+  if (replayMode != REPLAY_OFF) return;  // Replay plans are temporary
+  BootConfig config = {BOOT_CONFIG_VERSION, (uint16_t)freqSteps, sweepBegin, sweepEnd,
+                       rxBandwidth, (uint8_t)(adaptiveMode ? 1 : 0), {}};
+  BootConfig stored = {};
+  Preferences prefs;
+  if (!prefs.begin("boot", false)) return;
+  if (prefs.getBytes("config", &stored, sizeof(stored)) != sizeof(stored) ||
+      memcmp(&stored, &config, sizeof(config)) != 0) {
+    prefs.putBytes("config", &config, sizeof(config));
+  }
+  prefs.end();
+}
+
+void loop() {
+  // Allocations of the previous pass, for 'heap'
+  uint32_t allocs = heapAllocs;
+  loopAllocsLast = allocs - loopAllocsStart;
+  if (loopAllocsLast > loopAllocsMax) loopAllocsMax = loopAllocsLast;
+  loopAllocsStart = allocs;
+  loopPasses++;
+
+  if (captureState == CAPTURE_DWELL) {
+    // Full-rate samples at the frequency that fired, until the capture is complete
+    captureDwell();
+  } else if (surveyMode) {
+    // Sweeps on schedule and sleeps in between; the display stays off
+    surveyCycle();
+  } else {
+    // Update display continuously; this path must not allocate
+    uint32_t renderStart = heapAllocs;
+    updateDisplay();
+    renderAllocs += heapAllocs - renderStart;
+    
+    // Scan spectrum or monitor single frequency
+    if (streamMode) {
+      // The sampler task owns the radio; just forward what it collected
+      streamOutput();
+    } else if (cadenceMode) {
+      // The cadence task owns the radio; take its finished sweeps
+      cadenceOutput();
+    } else if (replayMode != REPLAY_OFF) {
+      // Recorded sweeps, paced by their timestamps or as fast as possible
+      if (scanning) replayCycle();
+    } else if (millis() - lastScanTime > SCAN_DELAY && scanning) {
+      if (singleFreqMode) {
+        monitorSingleFrequency();
+      } else if (watchSegments() > 0) {
+        scanWatch();
+      } else if (adaptiveMode) {
+        scanAdaptive();
+      } else {
+        scanSpectrum();
+      }
+      lastScanTime = millis();
     }
-    lastScanTime = millis();
   }
   
   // Handle any serial commands
   if (Serial.available()) {
     String command = Serial.readStringUntil('\n');
     command.trim();
+
+    // Recorded sweeps for 'replay serial' are data, not commands
+    if (replayFromSerial && command.startsWith("{")) {
+      // One sweep at a time: a new line must not replace one not yet scanned
+      // (sweep_capture.py waits for each snapshot before sending the next)
+      if (replayPending || replayLoaded) {
+        LOG_WARN("Replay: previous sweep not scanned yet, line dropped");
+      } else if (replay.loadJson(command.c_str())) {
+        replayPending = true;
+      } else {
+        LOG_WARN("Replay: line is not a valid sweep, ignored");
+      }
+      return;
+    }
+    String rawCommand = command;  // File names keep their case
     command.toLowerCase();
+
+    // The stream sampler owns the radio, so anything but status queries stops it
+    if (streamMode && command.length() > 0 && command != "info" && !command.startsWith("log ")) {
+      stopStream();
+    }
+    // Commands that retune or change the sweep pause the cadence task around them
+    bool resumeCadence = cadenceMode && command.length() > 0 && !cadenceKeepsRunning(command);
+    if (resumeCadence) stopCadence();
     
     if (command == "scan") {
+      if (surveyMode) stopSurvey();
       currentStep = 0;
       scanning = true;
       singleFreqMode = false;  // Exit single frequency mode
-      statusMessage = "Scanning...";
+      setStatus("Scanning...");
       Serial.println("Starting full spectrum scan...");
     } else if (command == "stop") {
       scanning = false;
-      statusMessage = "Stopped";
+      setStatus("Stopped");
       Serial.println("Scanning stopped - type 'scan' to resume");
     } else if (command == "pause") {
       scanning = false;
-      statusMessage = "Paused";
+      setStatus("Paused");
       Serial.println("Scanning paused - type 'scan' to resume");
     } else if (command == "help") {
       Serial.println("Available commands:");
       Serial.println("  scan - Start full spectrum scanning");
       Serial.println("  stop/pause - Stop scanning");
       Serial.println("  freq <MHz> - Monitor single frequency");
+      Serial.println("  stream <MHz> - Continuous high-rate RSSI stream with burst statistics");
       Serial.println("  band868 - Set 868 MHz band");
       Serial.println("  band915 - Set 915 MHz band");
       Serial.println("  band433 - Set 433 MHz band");
@@ -170,8 +684,41 @@ void loop() {
       Serial.println("  band446 - Set 446 MHz PMR band");
       Serial.println("  test - Enable test mode with simulated signals");
       Serial.println("  notest - Disable test mode");
+      Serial.println("  bins <n> - Set sweep resolution (16-1024 bins)");
+      Serial.println("  zoom <MHz> <MHz> - Show a sub-range on the display");
+      Serial.println("  span <MHz> <MHz> - Show center/width on the display");
+      Serial.println("  unzoom - Show the full sweep on the display");
+      Serial.println("  plan <MHz> <MHz> <s> - Gapless sweep plan for span and sweep time");
+      Serial.println("  plan - Show coverage of the current sweep");
+      Serial.println("  cadence <ms> - Timer-paced sweep, one every <ms>, with overrun reporting");
+      Serial.println("  cadence - Cadence statistics and recent overruns");
+      Serial.println("  nocadence - Back to the loop()-paced sweep");
+      Serial.println("  survey <s> - Low-power mode: one sweep every <s> seconds, sleep between");
+      Serial.println("  nosurvey - Leave low-power survey mode");
+      Serial.println("  adaptive - Adaptive dwell sweep (focus on active bins)");
+      Serial.println("  watch <MHz> <MHz> <ms> [prio] - Fine sweep of a segment every <ms>, between survey bins");
+      Serial.println("  watch band433/446/868/915 [ms] [prio] - Watch a preset band");
+      Serial.println("  watch survey <s> - Revisit target of the full-span survey while watching");
+      Serial.println("  watch - Watch list with passes and missed deadlines");
+      Serial.println("  unwatch [n] - Drop watch entry <n>, or all of them");
+      Serial.println("  noadaptive - Fixed round-robin sweep");
       Serial.println("  reset - Reset spectrum data");
+      Serial.println("  occ - Channel occupancy report (1 min / 10 min / 1 h)");
+      Serial.println("  occ <dBm> - Set occupancy threshold and restart statistics");
+      Serial.println("  baseline - Learned noise floor for the current sweep plan");
+      Serial.println("  baseline save - Write the noise floor to flash now");
+      Serial.println("  baseline clear - Forget the noise floor and relearn it");
+      Serial.println("  replay <file> [fast] - Sweep a LittleFS capture instead of the radio");
+      Serial.println("  replay serial [fast] - Sweep JSON snapshots sent over serial");
+      Serial.println("  noreplay - Back to the radio");
+      Serial.println("  trigger <MHz> <MHz> <dBm> [hits] - Only send sweeps around a signal in the range");
+      Serial.println("  trigger - Show the trigger and capture settings");
+      Serial.println("  notrigger - Send every sweep again");
+      Serial.println("  capture <pre> <post> - Sweeps kept before and after a trigger");
+      Serial.println("  capture <pre> dwell <n> - Then <n> full-rate samples at the trigger frequency");
       Serial.println("  info - Show current settings");
+      Serial.println("  log <level> - Log level: off, error, warn, info, debug");
+      Serial.println("  heap - Free heap and allocations per loop() pass");
     } else if (command.startsWith("freq ")) {
       String freqStr = command.substring(5);
       float newFreq = freqStr.toFloat();
@@ -179,164 +726,451 @@ void loop() {
         // Set single frequency monitoring mode
         singleFreq = newFreq;
         singleFreqMode = true;
-        radio.setFrequency(newFreq);
-        radio.startReceive();
-        statusMessage = "Monitoring: " + String(newFreq, 1) + " MHz";
+        spectrumRadio.tune(newFreq);
+        setStatus("Monitoring: %.1f MHz", newFreq);
         Serial.println("Monitoring single frequency: " + String(newFreq, 1) + " MHz");
         Serial.println("Type 'scan' to return to full spectrum scanning");
       } else {
         Serial.println("Frequency must be between 400-960 MHz");
       }
+    } else if (command.startsWith("bins ")) {
+      int bins = command.substring(5).toInt();
+      if (bins >= MIN_FREQ_STEPS && bins <= MAX_FREQ_STEPS) {
+        setSweepBins(bins);
+        setStatus("%d bins", bins);
+        Serial.println("Sweep resolution: " + String(bins) + " bins, " +
+                       String((sweepEnd - sweepBegin) * 1000.0 / bins, 1) + " kHz step");
+      } else {
+        Serial.println("Bins must be between " + String(MIN_FREQ_STEPS) + "-" + String(MAX_FREQ_STEPS));
+      }
+    } else if (command.startsWith("zoom ") || command.startsWith("span ")) {
+      String args = command.substring(5);
+      args.trim();
+      int sep = args.indexOf(' ');
+      float a = args.toFloat();
+      float b = sep > 0 ? args.substring(sep + 1).toFloat() : 0.0;
+      float beginMHz = a, endMHz = b;
+      if (command.startsWith("span ")) {
+        beginMHz = a - b / 2.0;
+        endMHz = a + b / 2.0;
+      }
+      if (sep > 0 && endMHz > beginMHz && beginMHz < sweepEnd && endMHz > sweepBegin) {
+        setZoom(beginMHz, endMHz);
+        setStatus("Zoom %.0f-%.0f", binFrequency(zoomFirst), binFrequency(zoomFirst + zoomCount));
+        Serial.println("Display span: " + String(binFrequency(zoomFirst), 2) + " - " +
+                       String(binFrequency(zoomFirst + zoomCount), 2) + " MHz (" +
+                       String(zoomCount) + " bins)");
+      } else {
+        Serial.println("Usage: zoom <startMHz> <endMHz> or span <centerMHz> <widthMHz>");
+      }
+    } else if (command.startsWith("plan ")) {
+      String args = command.substring(5);
+      args.trim();
+      int sep1 = args.indexOf(' ');
+      int sep2 = sep1 > 0 ? args.indexOf(' ', sep1 + 1) : -1;
+      float beginMHz = args.toFloat();
+      float endMHz = sep1 > 0 ? args.substring(sep1 + 1).toFloat() : 0.0;
+      float seconds = sep2 > 0 ? args.substring(sep2 + 1).toFloat() : 0.0;
+      if (sep2 > 0 && beginMHz >= FREQ_BEGIN && endMHz <= FREQ_END && endMHz > beginMHz && seconds > 0.0) {
+        SweepPlan plan = planSweep(beginMHz, endMHz, (unsigned long)(seconds * 1000.0));
+        applySweepPlan(plan);
+        printSweepPlan(plan);
+        setStatus("Plan %.0f%% cov", plan.coverage * 100.0);
+      } else {
+        Serial.println("Usage: plan <startMHz> <endMHz> <sweepSeconds> (within " +
+                       String(FREQ_BEGIN, 0) + "-" + String(FREQ_END, 0) + " MHz)");
+      }
+    } else if (command == "plan") {
+      SweepPlan current;
+      current.begin = sweepBegin;
+      current.end = sweepEnd;
+      current.rxBandwidth = rxBandwidth;
+      current.bins = freqSteps;
+      current.coverage = coverageFraction(sweepBegin, sweepEnd, freqSteps, rxBandwidth);
+      current.sweepMs = freqSteps * estimatedBinTime();
+      printSweepPlan(current);
+    } else if (command == "unzoom") {
+      setZoom(sweepBegin, sweepEnd);
+      setStatus("Scanning...");
+      Serial.println("Display span: full sweep");
+    } else if (command.startsWith("stream ")) {
+      float newFreq = command.substring(7).toFloat();
+      if (newFreq >= 400.0 && newFreq <= 960.0) {
+        startStream(newFreq);
+      } else {
+        Serial.println("Frequency must be between 400-960 MHz");
+      }
+    } else if (command == "stream") {
+      // Bare 'stream' just stops a running stream (handled above)
     } else if (command == "band868") {
-      radio.setFrequency(BAND_868);
-      radio.startReceive();
-      statusMessage = "Band: 868 MHz";
+      spectrumRadio.tune(BAND_868);
+      setStatus("Band: 868 MHz");
       Serial.println("Set to 868 MHz band");
     } else if (command == "band915") {
-      radio.setFrequency(BAND_915);
-      radio.startReceive();
-      statusMessage = "Band: 915 MHz";
+      spectrumRadio.tune(BAND_915);
+      setStatus("Band: 915 MHz");
       Serial.println("Set to 915 MHz band");
     } else if (command == "band433") {
-      radio.setFrequency(BAND_433);
-      radio.startReceive();
-      statusMessage = "Band: 433 MHz";
+      spectrumRadio.tune(BAND_433);
+      setStatus("Band: 433 MHz");
       Serial.println("Set to 433 MHz band");
     } else if (command == "band470") {
-      radio.setFrequency(BAND_470);
-      radio.startReceive();
-      statusMessage = "Band: 470 MHz";
+      spectrumRadio.tune(BAND_470);
+      setStatus("Band: 470 MHz");
       Serial.println("Set to 470 MHz band");
     } else if (command == "band800") {
-      radio.setFrequency(BAND_800);
-      radio.startReceive();
-      statusMessage = "Band: 800 MHz";
+      spectrumRadio.tune(BAND_800);
+      setStatus("Band: 800 MHz");
       Serial.println("Set to 800 MHz band");
     } else if (command == "band900") {
-      radio.setFrequency(BAND_900);
-      radio.startReceive();
-      statusMessage = "Band: 900 MHz";
+      spectrumRadio.tune(BAND_900);
+      setStatus("Band: 900 MHz");
       Serial.println("Set to 900 MHz band");
     } else if (command == "band435") {
-      radio.setFrequency(BAND_AMATEUR_70CM);
-      radio.startReceive();
-      statusMessage = "Band: 435 MHz";
+      spectrumRadio.tune(BAND_AMATEUR_70CM);
+      setStatus("Band: 435 MHz");
       Serial.println("Set to 435 MHz amateur band");
     } else if (command == "band446") {
-      radio.setFrequency(BAND_PM446);
-      radio.startReceive();
-      statusMessage = "Band: 446 MHz";
+      spectrumRadio.tune(BAND_PM446);
+      setStatus("Band: 446 MHz");
       Serial.println("Set to 446 MHz PMR band");
     } else if (command == "test") {
       testMode = true;
       testSignalFreq = 915.0; // Default test signal at 915 MHz
-      statusMessage = "Test mode ON";
+      setStatus("Test mode ON");
       Serial.println("Test mode enabled - simulating signals at 915 MHz");
     } else if (command == "notest") {
       testMode = false;
-      statusMessage = "Test mode OFF";
+      setStatus("Test mode OFF");
       Serial.println("Test mode disabled");
-    } else if (command == "reset") {
-      for (int i = 0; i < FREQ_STEPS; i++) {
-        spectrumData[i] = -100.0;
+    } else if (command.startsWith("survey ")) {
+      float seconds = command.substring(7).toFloat();
+      if (seconds >= 1.0) {
+        startSurvey((unsigned long)(seconds * 1000.0));
+      } else {
+        Serial.println("Survey interval must be at least 1 second");
       }
-      maxRSSI = -200.0;
-      minRSSI = 0.0;
+    } else if (command == "nosurvey") {
+      stopSurvey();
+    } else if (command == "adaptive" && watchSegments() > 0) {
+      // loop() runs the watch scheduler first, so adaptive would never get the radio
+      Serial.println("The watch list schedules the sweep; clear it first ('unwatch')");
+    } else if (command == "adaptive") {
+      adaptiveMode = true;
+      singleFreqMode = false;
+      resetAdaptiveState();
+      saveBootConfig();
+      setStatus("Adaptive scan");
+      Serial.println("Adaptive sweep enabled - quiet bins sampled less, active bins more");
+    } else if (command == "noadaptive") {
+      adaptiveMode = false;
+      currentStep = 0;
+      saveBootConfig();
+      setStatus("Scanning...");
+      Serial.println("Adaptive sweep disabled - fixed round-robin scanning");
+    } else if (command == "reset") {
+      resetSpectrumData();
       currentStep = 0;
-      statusMessage = "Data reset";
+      resetAdaptiveState();
+      recomputeAllColumns();
+      setStatus("Data reset");
       Serial.println("Spectrum data reset");
+    } else if (command.startsWith("replay ")) {
+      String source = rawCommand.substring(7);
+      source.trim();
+      bool fast = command.endsWith(" fast");
+      if (fast) {
+        source = source.substring(0, source.length() - 5);
+        source.trim();
+      }
+      if (source.equalsIgnoreCase("serial")) source = "serial";
+      startReplay(source, fast);
+    } else if (command == "noreplay") {
+      stopReplay();
+    } else if (command == "baseline") {
+      printBaselineInfo();
+    } else if (command == "baseline save") {
+      if (baselineSave()) lastBaselineSave = millis();
+      Serial.println(baselineDirty() ? "Baseline save failed" : "Baseline saved");
+    } else if (command == "baseline clear") {
+      baselineClear();
+      resetSpectrumData();
+      resetAdaptiveState();
+      recomputeAllColumns();
+      Serial.println("Baseline cleared, relearning from the next sweep");
+    } else if (command == "occ") {
+      printOccupancyReport();
+    } else if (command.startsWith("occ ")) {
+      float threshold = command.substring(4).toFloat();
+      if (threshold < 0.0 && threshold > -160.0) {
+        occupancyReset(freqSteps, threshold, millis());
+        Serial.println("Occupancy threshold: " + String(threshold, 1) + " dBm, statistics restarted");
+      } else {
+        Serial.println("Usage: occ <dBm>, e.g. occ -90");
+      }
+    } else if (command.startsWith("trigger ")) {
+      String args = command.substring(8);
+      args.trim();
+      int sep1 = args.indexOf(' ');
+      int sep2 = sep1 > 0 ? args.indexOf(' ', sep1 + 1) : -1;
+      int sep3 = sep2 > 0 ? args.indexOf(' ', sep2 + 1) : -1;
+      TriggerCondition condition;
+      condition.beginMHz = args.toFloat();
+      condition.endMHz = sep1 > 0 ? args.substring(sep1 + 1).toFloat() : 0.0;
+      condition.thresholdDbm = sep2 > 0 ? args.substring(sep2 + 1).toFloat() : 0.0;
+      condition.hits = sep3 > 0 ? args.substring(sep3 + 1).toInt() : 1;
+      if (sep2 > 0 && condition.endMHz > condition.beginMHz && condition.thresholdDbm < 0.0 &&
+          condition.hits >= 1) {
+        triggerSet(condition);
+        if (armCapture()) {
+          setStatus("Trigger armed");
+          printCaptureInfo();
+        } else {
+          Serial.println("Capture window does not fit " + String(freqSteps) + " bins, max " +
+                         String(captureRowsFor(freqSteps)) + " sweeps");
+        }
+      } else {
+        Serial.println("Usage: trigger <startMHz> <endMHz> <dBm> [hits], e.g. trigger 433 435 -80 2");
+      }
+    } else if (command == "trigger") {
+      printCaptureInfo();
+    } else if (command == "notrigger") {
+      disarmCapture();
+      setStatus("Scanning...");
+      Serial.println("Trigger off - every sweep is sent");
+    } else if (command.startsWith("capture ")) {
+      String args = command.substring(8);
+      args.trim();
+      int sep = args.indexOf(' ');
+      int pre = args.toInt();
+      String rest = sep > 0 ? args.substring(sep + 1) : "";
+      rest.trim();
+      int post = 0, dwell = 0;
+      if (rest.startsWith("dwell ")) {
+        dwell = rest.substring(6).toInt();
+      } else {
+        post = rest.toInt();
+      }
+      bool valid = sep > 0 && pre >= 0 && (post >= 1 || (dwell >= 1 && dwell <= CAPTURE_DWELL_MAX));
+      if (valid && max(pre + post, 1) <= captureRowsFor(freqSteps)) {
+        capturePre = pre;
+        capturePost = post;
+        captureDwellSamples = dwell;
+        if (captureState != CAPTURE_OFF) armCapture();
+        printCaptureInfo();
+      } else if (valid) {
+        Serial.println("At " + String(freqSteps) + " bins at most " + String(captureRowsFor(freqSteps)) +
+                       " sweeps fit");
+      } else {
+        Serial.println("Usage: capture <pre> <post> or capture <pre> dwell <samples> (1-" +
+                       String(CAPTURE_DWELL_MAX) + ")");
+      }
+    } else if (command.startsWith("watch survey ")) {
+      float seconds = command.substring(13).toFloat();
+      if (seconds >= 1.0) {
+        watchSurveyMs = (unsigned long)(seconds * 1000.0);
+        watchSetSurvey(sweepBegin, sweepEnd, freqSteps, watchSurveyMs, millis());
+        Serial.println("Survey revisit target: " + String(seconds, 1) + " s");
+      } else {
+        Serial.println("Survey interval must be at least 1 second");
+      }
+    } else if (command.startsWith("watch band")) {
+      String args = command.substring(6);
+      int sep1 = args.indexOf(' ');
+      int sep2 = sep1 > 0 ? args.indexOf(' ', sep1 + 1) : -1;
+      String name = sep1 > 0 ? args.substring(0, sep1) : args;
+      const WatchPreset* preset = nullptr;
+      for (int i = 0; i < WATCH_PRESET_COUNT; i++) {
+        if (name == WATCH_PRESETS[i].name) preset = &WATCH_PRESETS[i];
+      }
+      long intervalMs = sep1 > 0 ? args.substring(sep1 + 1).toInt() : 0;
+      int priority = sep2 > 0 ? args.substring(sep2 + 1).toInt() : 0;
+      if (preset && (sep1 < 0 || intervalMs >= WATCH_MIN_INTERVAL_MS) && priority >= 0 && priority <= 255) {
+        addWatch(preset->begin, preset->end, sep1 > 0 ? intervalMs : preset->intervalMs,
+                 sep2 > 0 ? priority : preset->priority);
+      } else {
+        Serial.println("Usage: watch band433|band446|band868|band915 [ms] [priority]");
+      }
+    } else if (command.startsWith("watch ")) {
+      String args = command.substring(6);
+      args.trim();
+      int sep1 = args.indexOf(' ');
+      int sep2 = sep1 > 0 ? args.indexOf(' ', sep1 + 1) : -1;
+      int sep3 = sep2 > 0 ? args.indexOf(' ', sep2 + 1) : -1;
+      float beginMHz = args.toFloat();
+      float endMHz = sep1 > 0 ? args.substring(sep1 + 1).toFloat() : 0.0;
+      long intervalMs = sep2 > 0 ? args.substring(sep2 + 1).toInt() : 0;
+      int priority = sep3 > 0 ? args.substring(sep3 + 1).toInt() : WATCH_PRIORITY;
+      if (sep2 > 0 && beginMHz >= FREQ_BEGIN && endMHz <= FREQ_END && endMHz > beginMHz &&
+          intervalMs >= WATCH_MIN_INTERVAL_MS && priority >= 0 && priority <= 255) {
+        addWatch(beginMHz, endMHz, intervalMs, priority);
+      } else {
+        Serial.println("Usage: watch <startMHz> <endMHz> <intervalMs> [priority], e.g. watch 446.0 446.2 250 3");
+      }
+    } else if (command == "watch") {
+      printWatchList();
+    } else if (command.startsWith("unwatch ")) {
+      int entry = command.substring(8).toInt();
+      if (watchRemove(entry)) {
+        Serial.println("Watch " + String(entry) + " removed, " + String(watchSegments()) + " left");
+        if (watchSegments() == 0) setStatus(adaptiveMode ? "Adaptive scan" : "Scanning...");
+      } else {
+        Serial.println("No watch entry " + String(entry) + " (the survey is entry 0)");
+      }
+    } else if (command == "unwatch") {
+      watchClear();
+      setStatus(adaptiveMode ? "Adaptive scan" : "Scanning...");
+      Serial.println(adaptiveMode ? "Watch list cleared - back to the adaptive sweep"
+                                  : "Watch list cleared - back to the plain sweep");
+    } else if (command.startsWith("log ")) {
+      String name = command.substring(4);
+      name.trim();
+      int level = logLevelFromName(name.c_str());
+      if (level >= 0) {
+        logLevel = level;
+        Serial.println("Log level: " + name);
+      } else {
+        Serial.println("Log levels: off, error, warn, info, debug");
+      }
+    } else if (command.startsWith("cadence ")) {
+      long periodMs = command.substring(8).toInt();
+      if (periodMs <= 0) {
+        Serial.println("Usage: cadence <sweepPeriodMs>, e.g. cadence 2000");
+      } else if (replayMode != REPLAY_OFF) {
+        Serial.println("Cadence drives the radio; stop the replay first ('noreplay')");
+      } else {
+        if (surveyMode) stopSurvey();
+        singleFreqMode = false;
+        scanning = true;
+        startCadence(periodMs);
+      }
+    } else if (command == "cadence") {
+      printCadenceInfo();
+    } else if (command == "nocadence") {
+      stopCadence();
+      currentStep = 0;
+      setStatus("Scanning...");
+      Serial.println("Cadence off - sweep paced by loop() again");
+    } else if (command == "heap") {
+      printHeapInfo();
     } else if (command == "info") {
       Serial.println("=== Spectrum Analyzer Info ===");
-      Serial.println("Frequency range: " + String(FREQ_BEGIN, 1) + " - " + String(FREQ_END, 1) + " MHz");
-      Serial.println("Frequency steps: " + String(FREQ_STEPS));
+      Serial.println("Frequency range: " + String(sweepBegin, 1) + " - " + String(sweepEnd, 1) + " MHz");
+      Serial.println("Frequency steps: " + String(freqSteps) + " (" +
+                     String((sweepEnd - sweepBegin) * 1000.0 / freqSteps, 1) + " kHz step)");
+      Serial.println("RX bandwidth: " + String(rxBandwidth, 1) + " kHz, coverage " +
+                     String(coverageFraction(sweepBegin, sweepEnd, freqSteps, rxBandwidth) * 100.0, 1) + "%");
+      Serial.println("Last sweep: " + String(lastSweepDuration) + " ms");
+      Serial.println("Boot: setup " + String(setupDoneMs) + " ms, first sweep " + String(firstSweepMs) + " ms");
+      if (surveyMode) {
+        Serial.println("Survey: every " + String(surveyInterval / 1000.0, 1) + " s, " +
+                       String(surveyCount) + " sweeps, last awake " + String(lastSurveyAwakeMs) +
+                       " ms, " + String(lastSurveyEnergy, 1) + " mJ/sweep");
+      }
+      Serial.println("Display span: " + String(binFrequency(zoomFirst), 2) + " - " +
+                     String(binFrequency(zoomFirst + zoomCount), 2) + " MHz on " +
+                     String(DISPLAY_COLUMNS) + " columns");
       Serial.println("Current step: " + String(currentStep));
       Serial.println("RSSI range: " + String(minRSSI, 1) + " to " + String(maxRSSI, 1) + " dBm");
-      Serial.println("Status: " + statusMessage);
+      Serial.println("Status: " + String(statusMessage));
+      Serial.println("Log: " + String(logLevelName(logLevel)) + ", " + String(logDropped()) + " messages dropped");
+      Serial.println("Baseline: " + String(baselineTrainedBins()) + "/" + String(freqSteps) + " bins learned");
+      if (captureState != CAPTURE_OFF) {
+        printCaptureInfo();
+      }
+      if (watchSegments() > 0) {
+        printWatchList();
+      }
+      if (cadenceMode) {
+        printCadenceInfo();
+      }
+      printHeapInfo();
+      if (streamMode) {
+        BurstStats stats;
+        portENTER_CRITICAL(&streamLock);
+        stats = streamStats;
+        portEXIT_CRITICAL(&streamLock);
+        printStreamStats(stats);
+      }
+      if (adaptiveMode) {
+        int hot = 0, idle = 0;
+        unsigned long now = millis();
+        for (int i = 0; i < freqSteps; i++) {
+          if (isBinHot(i, now)) hot++;
+          else if (binQuietCount[i] >= ADAPTIVE_QUIET_VISITS) idle++;
+        }
+        Serial.println("Adaptive: " + String(hot) + " hot, " + String(idle) + " idle, " +
+                       String(freqSteps - hot - idle) + " normal bins");
+      }
     } else if (command.length() > 0) {
       Serial.print("Unknown command: '");
       Serial.print(command);
       Serial.println("'. Type 'help' for available commands.");
     }
+
+    if (resumeCadence) {
+      bool sweeping = scanning && !singleFreqMode && !streamMode && !surveyMode && replayMode == REPLAY_OFF;
+      if (!sweeping || !startCadence(cadenceRequestMs)) {
+        Serial.println("Cadence stopped - 'cadence <ms>' to restart");
+      }
+    }
   }
 }
 
 void initializeRadio() {
-  // Initialize LoRa (SX1262) in FSK mode for better spectrum analysis
-  int state = radio.beginFSK(FREQ_BEGIN);
+  // FSK mode with the active RX bandwidth, which must be one of RX_BANDWIDTHS
+  int state = spectrumRadio.begin(sweepBegin, rxBandwidth);
   if (state != RADIOLIB_ERR_NONE) {
-    Serial.print("Radio initialization failed! Code: ");
-    Serial.println(state);
-    statusMessage = "Radio init failed!";
+    LOG_ERROR("Radio initialization failed! Code: %d", state);
+    setStatus("Radio init failed!");
     return;
   }
   
-  // Configure for spectrum analysis
-  radio.setRxBandwidth(250.0);  // 250 kHz bandwidth
-  radio.setDataShaping(RADIOLIB_SHAPING_NONE);
-  
-  // Start in receive mode
-  radio.startReceive();
-  
-  Serial.println("Radio initialized for spectrum analysis");
+  LOG_INFO("Radio initialized for spectrum analysis");
 }
 
 void scanSpectrum() {
   // Only scan if scanning is enabled
   if (scanning) {
     // Continuous scanning mode - scan one step at a time
-    float frequency = FREQ_BEGIN + (currentStep * (FREQ_END - FREQ_BEGIN) / FREQ_STEPS);
-    float rssi = getRSSIAtFrequency(frequency);
-    
-    spectrumData[currentStep] = rssi;
+    if (currentStep == 0) {
+      sweepStartTime = millis();
+    }
+    float frequency = binCenterFrequency(currentStep);
+    bool measured;
+    float rssi = getRSSIAtFrequency(frequency, RSSI_SAMPLES, SETTLE_DELAY, &measured);
     
-    // Update min/max for scaling
-    if (rssi > maxRSSI) maxRSSI = rssi;
-    if (rssi < minRSSI) minRSSI = rssi;
+    setBin(currentStep, rssi);
+    recordBinVisit(currentStep, rssi, measured);
     
     currentStep++;
-    if (currentStep >= FREQ_STEPS) {
+    if (currentStep >= freqSteps) {
       currentStep = 0;
+      lastSweepDuration = millis() - sweepStartTime;
       // Emit one JSON snapshot over Serial after each full sweep
       printJsonSnapshot();
+      maybeSaveBaseline();
     }
     
     // Print to serial for debugging
     if (currentStep % 10 == 0) {
-      Serial.print("Freq: "); Serial.print(frequency, 1);
-      Serial.print(" MHz, RSSI: "); Serial.print(rssi, 1); Serial.println(" dBm");
+      LOG_DEBUG("Freq: %.1f MHz, RSSI: %.1f dBm", frequency, rssi);
     }
   }
 }
 
-float getRSSIAtFrequency(float frequency) {
-  // Set radio to the specified frequency
-  radio.setFrequency(frequency);
-  radio.startReceive();
-  
-  // Wait for radio to settle
-  delay(10);
-  
-  // Read RSSI multiple times for better accuracy
-  float rssiSum = 0;
-  int validReadings = 0;
-  
-  for (int i = 0; i < 5; i++) {
-    float rssi = radio.getRSSI();
-    if (rssi > -200.0 && rssi < 0.0) { // Valid RSSI range
-      rssiSum += rssi;
-      validReadings++;
-    }
-    delay(2);
-  }
-  
+// `measured` (optional) is false when the radio gave nothing and the value is a
+// stand-in; such values must not feed the baseline or the statistics
+float getRSSIAtFrequency(float frequency, int samples, int settleMs, bool* measured) {
+  // Tune, settle and average through the shared hot path
+  spectrumRadio.tune(frequency);
   float avgRSSI;
-  if (validReadings > 0) {
-    avgRSSI = rssiSum / validReadings;
-  } else {
-    // Generate realistic noise floor based on frequency
-    float noiseBase = -120.0; // Base noise floor
-    float freqVariation = (frequency - 600.0) / 100.0; // Add some frequency-based variation
-    avgRSSI = noiseBase + freqVariation + random(-10, 5); // -130 to -115 dBm range
+  bool valid = spectrumRadio.readRSSI(avgRSSI, samples, settleMs);
+  if (measured) *measured = valid;
+  if (!valid) {
+    // No valid reading: fall back to what this bin normally looks like
+    int bin = (int)((frequency - sweepBegin) * freqSteps / (sweepEnd - sweepBegin));
+    avgRSSI = baselineTrained(bin) ? baselineFloor(bin) : spectrum::syntheticNoise(frequency);
   }
   
   // Test mode: add simulated signals
@@ -359,23 +1193,1008 @@ float getRSSIAtFrequency(float frequency) {
   return avgRSSI;
 }
 
+// Lower edge of a sweep bin
+float binFrequency(int bin) {
+  return sweepBegin + (bin * (sweepEnd - sweepBegin) / freqSteps);
+}
+
+// The radio is tuned to the bin centre so its RX bandwidth covers the whole step
+float binCenterFrequency(int bin) {
+  return sweepBegin + ((bin + 0.5) * (sweepEnd - sweepBegin) / freqSteps);
+}
+
+// Rough time spent per bin by scanSpectrum(), including the loop() gap
+unsigned long estimatedBinTime() {
+  return (SCAN_DELAY + 1) + SETTLE_DELAY + (RSSI_SAMPLES * spectrumRadio.sampleIntervalUs() + 999) / 1000;
+}
+
+// Fraction of the span that falls inside the RX bandwidth of some bin
+float coverageFraction(float beginMHz, float endMHz, int bins, float bwKHz) {
+  float stepKHz = (endMHz - beginMHz) * 1000.0 / bins;
+  return bwKHz >= stepKHz ? 1.0 : bwKHz / stepKHz;
+}
+
+// Pick the narrowest RX bandwidth whose gapless bin count fits both the storage
+// and the time budget. If even the widest bandwidth cannot be made gapless, use
+// it with as many bins as fit and report the coverage that leaves.
+SweepPlan planSweep(float beginMHz, float endMHz, unsigned long targetMs) {
+  SweepPlan plan;
+  plan.begin = beginMHz;
+  plan.end = endMHz;
+
+  float spanKHz = (endMHz - beginMHz) * 1000.0;
+  long maxBins = targetMs / estimatedBinTime();
+  if (maxBins > MAX_FREQ_STEPS) maxBins = MAX_FREQ_STEPS;
+  if (maxBins < MIN_FREQ_STEPS) maxBins = MIN_FREQ_STEPS;
+
+  plan.rxBandwidth = RX_BANDWIDTHS[RX_BANDWIDTH_COUNT - 1];
+  plan.bins = maxBins;
+  for (int i = 0; i < RX_BANDWIDTH_COUNT; i++) {
+    long bins = (long)ceil(spanKHz / RX_BANDWIDTHS[i]);
+    if (bins < MIN_FREQ_STEPS) bins = MIN_FREQ_STEPS;
+    if (bins <= maxBins) {
+      plan.rxBandwidth = RX_BANDWIDTHS[i];
+      plan.bins = bins;
+      break;
+    }
+  }
+
+  plan.coverage = coverageFraction(beginMHz, endMHz, plan.bins, plan.rxBandwidth);
+  plan.sweepMs = plan.bins * estimatedBinTime();
+  return plan;
+}
+
+void applySweepPlan(const SweepPlan& plan) {
+  int state = spectrumRadio.setRxBandwidth(plan.rxBandwidth);
+  if (state != RADIOLIB_ERR_NONE) {
+    LOG_ERROR("RX bandwidth rejected! Code: %d", state);
+    return;
+  }
+  rxBandwidth = plan.rxBandwidth;
+  sweepBegin = plan.begin;
+  sweepEnd = plan.end;
+  setSweepBins(plan.bins);
+}
+
+void printSweepPlan(const SweepPlan& plan) {
+  Serial.println("Sweep plan: " + String(plan.begin, 2) + " - " + String(plan.end, 2) + " MHz");
+  Serial.println("  Bins: " + String(plan.bins) + ", step " +
+                 String((plan.end - plan.begin) * 1000.0 / plan.bins, 1) + " kHz");
+  Serial.println("  RX bandwidth: " + String(plan.rxBandwidth, 1) + " kHz");
+  Serial.println("  Coverage: " + String(plan.coverage * 100.0, 1) + "%" +
+                 (plan.coverage >= 1.0 ? " (gapless)" : " (gaps between bins)"));
+  Serial.println("  Estimated sweep time: " + String(plan.sweepMs) + " ms");
+}
+
+// Store one bin reading and fold it into the display columns that cover it
+void setBin(int bin, float rssi) {
+  float old = spectrumData[bin];
+  spectrumData[bin] = rssi;
+
+  // Update min/max for scaling
+  if (rssi > maxRSSI) maxRSSI = rssi;
+  if (rssi < minRSSI) minRSSI = rssi;
+
+  if (bin < zoomFirst || bin >= zoomFirst + zoomCount) return;
+
+  // A bin maps to one column when decimating, several when zoomed past 1:1
+  int first = (long)(bin - zoomFirst) * DISPLAY_COLUMNS / zoomCount;
+  for (int c = max(0, first - 1); c < DISPLAY_COLUMNS; c++) {
+    int startBin = columnFirstBin(c);
+    if (startBin > bin) break;
+    if (bin >= columnEndBin(c)) continue;
+
+    // Only a reading that replaces the current extreme forces a rescan
+    if ((old == columnMax[c] && rssi < old) || (old == columnMin[c] && rssi > old)) {
+      recomputeColumn(c);
+    } else {
+      if (rssi > columnMax[c]) columnMax[c] = rssi;
+      if (rssi < columnMin[c]) columnMin[c] = rssi;
+    }
+  }
+}
+
+int columnFirstBin(int column) {
+  return zoomFirst + (long)column * zoomCount / DISPLAY_COLUMNS;
+}
+
+int columnEndBin(int column) {
+  int end = zoomFirst + (long)(column + 1) * zoomCount / DISPLAY_COLUMNS;
+  return max(end, columnFirstBin(column) + 1);
+}
+
+void recomputeColumn(int column) {
+  int end = columnEndBin(column);
+  float lo = spectrumData[columnFirstBin(column)];
+  float hi = lo;
+  for (int i = columnFirstBin(column) + 1; i < end; i++) {
+    if (spectrumData[i] < lo) lo = spectrumData[i];
+    if (spectrumData[i] > hi) hi = spectrumData[i];
+  }
+  columnMin[column] = lo;
+  columnMax[column] = hi;
+}
+
+void recomputeAllColumns() {
+  for (int c = 0; c < DISPLAY_COLUMNS; c++) {
+    recomputeColumn(c);
+  }
+}
+
+// Change the sweep resolution; stored data no longer lines up, so start over
+void setSweepBins(int bins) {
+  freqSteps = bins;
+  currentStep = 0;
+  baselineSelect(sweepBegin, sweepEnd, freqSteps, rxBandwidth);
+  resetSpectrumData();
+  resetAdaptiveState();
+  occupancyReset(freqSteps, occupancyThreshold(), millis());
+  zoomFirst = 0;
+  zoomCount = freqSteps;
+  recomputeAllColumns();
+  if (captureState != CAPTURE_OFF && !armCapture()) {
+    captureState = CAPTURE_OFF;
+    LOG_WARN("Capture window does not fit %d bins, trigger off", freqSteps);
+  }
+  watchSetSurvey(sweepBegin, sweepEnd, freqSteps, watchSurveyMs, millis());
+  saveBootConfig();
+}
+
+// Map a frequency sub-range of the sweep onto the display columns
+void setZoom(float beginMHz, float endMHz) {
+  float binWidth = (sweepEnd - sweepBegin) / freqSteps;
+  int first = (int)((beginMHz - sweepBegin) / binWidth);
+  int last = (int)ceil((endMHz - sweepBegin) / binWidth);
+  first = constrain(first, 0, freqSteps - 1);
+  last = constrain(last, first + 1, freqSteps);
+  zoomFirst = first;
+  zoomCount = last - first;
+  recomputeAllColumns();
+}
+
+void resetAdaptiveState() {
+  unsigned long now = millis();
+  for (int i = 0; i < MAX_FREQ_STEPS; i++) {
+    // The learned baseline is trusted right away; other bins start unmeasured
+    binNoiseFloor[i] = baselineTrained(i) ? baselineFloor(i) : NAN;
+    binFloorVisits[i] = baselineTrained(i) ? ADAPTIVE_FLOOR_VISITS : 0;
+    binLastVisit[i] = now - ADAPTIVE_MAX_REVISIT_MS;  // Everything due immediately
+    binLastActive[i] = now - ADAPTIVE_HOLD_MS;
+    binQuietCount[i] = 0;
+    binVisits[i] = 0;
+  }
+  adaptiveVisitCount = 0;
+  adaptiveSnapshotTime = now;
+}
+
+// A bin is hot while it, or a close neighbour, has shown activity recently
+bool isBinHot(int bin, unsigned long now) {
+  int first = max(0, bin - ADAPTIVE_NEIGHBOR_BINS);
+  int last = min(freqSteps - 1, bin + ADAPTIVE_NEIGHBOR_BINS);
+  for (int i = first; i <= last; i++) {
+    if (now - binLastActive[i] < ADAPTIVE_HOLD_MS) return true;
+  }
+  return false;
+}
+
+// Pick the next bin to visit: the most overdue one relative to its own revisit
+// interval, except that any bin past the fairness bound always goes first.
+int pickAdaptiveBin(unsigned long now) {
+  int best = 0;
+  long bestSlack = 0x7FFFFFFF;
+  int oldest = -1;
+  unsigned long oldestAge = 0;
+
+  for (int i = 0; i < freqSteps; i++) {
+    unsigned long age = now - binLastVisit[i];
+    if (age >= ADAPTIVE_MAX_REVISIT_MS && age > oldestAge) {
+      oldest = i;
+      oldestAge = age;
+    }
+
+    unsigned long interval;
+    if (isBinHot(i, now)) {
+      interval = ADAPTIVE_HOT_REVISIT_MS;
+    } else if (binQuietCount[i] >= ADAPTIVE_QUIET_VISITS) {
+      interval = ADAPTIVE_MAX_REVISIT_MS;
+    } else {
+      interval = ADAPTIVE_REVISIT_MS;
+    }
+
+    long slack = (long)interval - (long)age;  // Negative means overdue
+    if (slack < bestSlack) {
+      bestSlack = slack;
+      best = i;
+    }
+  }
+
+  return oldest >= 0 ? oldest : best;
+}
+
+void scanAdaptive() {
+  unsigned long now = millis();
+  int bin = pickAdaptiveBin(now);
+  float frequency = binCenterFrequency(bin);
+
+  // Dwell depends on the bin's recent history
+  bool hot = isBinHot(bin, now);
+  bool idle = !hot && binQuietCount[bin] >= ADAPTIVE_QUIET_VISITS;
+  float rssi;
+  bool measured;
+  if (hot) {
+    rssi = getRSSIAtFrequency(frequency, ADAPTIVE_HOT_SAMPLES, SETTLE_DELAY, &measured);
+  } else if (idle) {
+    rssi = getRSSIAtFrequency(frequency, ADAPTIVE_IDLE_SAMPLES, ADAPTIVE_IDLE_SETTLE, &measured);
+  } else {
+    rssi = getRSSIAtFrequency(frequency, RSSI_SAMPLES, SETTLE_DELAY, &measured);
+  }
+  now = millis();
+
+  setBin(bin, rssi);
+  recordBinVisit(bin, rssi, measured);
+
+  // Classify against the bin's noise floor. An untrained bin takes the
+  // minimum of its first readings, so a carrier present at the first visit
+  // isn't learned as the floor. After that quiet readings track the floor and
+  // active ones only nudge it up. A failed read says nothing about the bin,
+  // so it leaves floor and classification alone.
+  if (measured) {
+    bool learning = binFloorVisits[bin] < ADAPTIVE_FLOOR_VISITS;
+    if (learning) {
+      if (isnan(binNoiseFloor[bin]) || rssi < binNoiseFloor[bin]) binNoiseFloor[bin] = rssi;
+      binFloorVisits[bin]++;
+    }
+    float excess = rssi - binNoiseFloor[bin];
+    if (excess > ADAPTIVE_ACTIVE_MARGIN) {
+      binLastActive[bin] = now;
+      binQuietCount[bin] = 0;
+      if (!learning) binNoiseFloor[bin] += excess / ADAPTIVE_FLOOR_RISE;
+    } else {
+      if (!learning) binNoiseFloor[bin] += excess / ADAPTIVE_FLOOR_GAIN;
+      if (binQuietCount[bin] < 255) binQuietCount[bin]++;
+    }
+  }
+
+  binLastVisit[bin] = now;
+  if (binVisits[bin] < 0xFFFF) binVisits[bin]++;
+  currentStep = bin;  // Cursor on the display follows the visited bin
+
+  // One snapshot per freqSteps visits keeps the JSON rate comparable to a sweep
+  adaptiveVisitCount++;
+  if (adaptiveVisitCount % freqSteps == 0) {
+    sweepStartTime = adaptiveSnapshotTime;
+    lastSweepDuration = now - adaptiveSnapshotTime;
+    printJsonSnapshot();
+    maybeSaveBaseline();
+
+    int hotBins = 0;
+    uint16_t maxVisits = 0;
+    for (int i = 0; i < freqSteps; i++) {
+      if (isBinHot(i, now)) hotBins++;
+      if (binVisits[i] > maxVisits) maxVisits = binVisits[i];
+      binVisits[i] = 0;
+    }
+    LOG_INFO("Adaptive: %d hot bins, busiest bin visited %ux in %lu ms",
+             hotBins, maxVisits, now - adaptiveSnapshotTime);
+    adaptiveSnapshotTime = now;
+  }
+}
+
+// Watch list active: one bin of whichever pass the EDF scheduler picks. Survey
+// bins are the normal sweep (display, baseline, occupancy, trigger); segment
+// passes go out as their own compact lines.
+void scanWatch() {
+  unsigned long now = millis();
+  int entry = watchPick(now);
+  if (entry < 0) return;
+  int bin = watchNextBin(entry);
+
+  if (entry == WATCH_SURVEY) {
+    if (bin == 0) sweepStartTime = now;
+    bool measured;
+    float rssi = getRSSIAtFrequency(binCenterFrequency(bin), RSSI_SAMPLES, SETTLE_DELAY, &measured);
+    setBin(bin, rssi);
+    recordBinVisit(bin, rssi, measured);
+    currentStep = bin;
+  } else {
+    if (bin == 0) watchPassStart[entry] = now;
+    watchData[entry][bin] = getRSSIAtFrequency(watchBinCenter(entry, bin));
+  }
+
+  const WatchEntry& e = watchEntry(entry);
+  unsigned long deadline = e.release + e.intervalMs;
+  now = millis();
+  if (!watchVisited(entry, now)) return;
+
+  if ((long)(now - deadline) > 0) {
+    LOG_WARN("Watch %d (%.2f-%.2f MHz): pass done %lu ms after its deadline, %lu missed",
+             entry, e.beginMHz, e.endMHz, now - deadline, (unsigned long)e.missed);
+  }
+  if (entry == WATCH_SURVEY) {
+    lastSweepDuration = now - sweepStartTime;
+    printJsonSnapshot();
+    maybeSaveBaseline();
+  } else {
+    printWatchJson(entry);
+  }
+}
+
+// Register a segment, sized gapless at the active RX bandwidth where the
+// bin limit allows
+void addWatch(float beginMHz, float endMHz, unsigned long intervalMs, uint8_t priority) {
+  if (adaptiveMode) {
+    Serial.println("Adaptive mode schedules the sweep; turn it off first ('noadaptive')");
+    return;
+  }
+  if (watchSegments() == 0) {
+    watchSetSurvey(sweepBegin, sweepEnd, freqSteps, watchSurveyMs, millis());
+  }
+  int bins = (int)ceil((endMHz - beginMHz) * 1000.0 / rxBandwidth);
+  bins = constrain(bins, WATCH_MIN_BINS, WATCH_MAX_BINS);
+  int entry = watchAdd(beginMHz, endMHz, bins, intervalMs, priority, millis());
+  if (entry < 0) {
+    Serial.println("Watch list full (" + String(WATCH_MAX_ENTRIES - 1) + " segments)");
+    return;
+  }
+  singleFreqMode = false;
+  setStatus("Watching %d", watchSegments());
+  Serial.println("Watch " + String(entry) + ": " + String(beginMHz, 2) + " - " + String(endMHz, 2) + " MHz, " +
+                 String(bins) + " bins every " + String(intervalMs) + " ms, priority " + String(priority));
+
+  // EDF meets every deadline as long as the passes fit in the radio time
+  float load = watchUtilization(estimatedBinTime());
+  if (load > 1.0) {
+    Serial.println("Warning: the watch list needs " + String(load * 100.0, 0) +
+                   "% of the radio time; lowest priorities will miss deadlines");
+  }
+}
+
+// One segment pass, built in a fixed buffer like the stream's blocks
+void printWatchJson(int entry) {
+  static char line[256 + WATCH_MAX_BINS * 8];
+  const WatchEntry& e = watchEntry(entry);
+  int len = snprintf(line, sizeof(line),
+                     "{\"type\":\"watch\",\"id\":%d,\"timestamp\":%lu,\"deviceId\":\"heltec-v3\",\"seq\":%lu,"
+                     "\"sweepStart\":%lu,\"sweepEnd\":%lu,\"freqBegin\":%.3f,\"freqEnd\":%.3f,\"freqSteps\":%d,"
+                     "\"intervalMs\":%lu,\"priority\":%u,\"missed\":%lu,\"rssi\":[",
+                     entry, millis(), (unsigned long)e.passes, watchPassStart[entry], e.lastDone,
+                     e.beginMHz, e.endMHz, e.bins, e.intervalMs, e.priority, (unsigned long)e.missed);
+  for (int i = 0; i < e.bins && len < (int)sizeof(line) - 12; i++) {
+    len += snprintf(line + len, sizeof(line) - len, i ? ",%.1f" : "%.1f", watchData[entry][i]);
+  }
+  memcpy(line + len, "]}\n", 3);
+  len += 3;
+  Serial.write((const uint8_t*)line, len);
+}
+
+void printWatchList() {
+  unsigned long now = millis();
+  Serial.println("Watch list: " + String(watchSegments()) + " segments, radio load " +
+                 String(watchUtilization(estimatedBinTime()) * 100.0, 0) + "%");
+  for (int i = 0; i < WATCH_MAX_ENTRIES; i++) {
+    const WatchEntry& e = watchEntry(i);
+    if (!e.active) continue;
+    String name = i == WATCH_SURVEY ? "survey " : "";
+    Serial.println("  [" + String(i) + "] " + name + String(e.beginMHz, 2) + " - " + String(e.endMHz, 2) +
+                   " MHz, " + String(e.bins) + " bins every " + String(e.intervalMs) + " ms, priority " +
+                   String(e.priority));
+    Serial.println("      " + String(e.passes) + " passes, " + String(e.missed) + " missed (worst +" +
+                   String(e.worstLateMs) + " ms), " + String(e.skipped) + " skipped, worst revisit " +
+                   String(e.worstRevisitMs) + " ms" +
+                   (e.passes > 0 ? ", last " + String(now - e.lastDone) + " ms ago" : ""));
+  }
+}
+
+void startSurvey(unsigned long intervalMs) {
+  surveyMode = true;
+  surveyInterval = intervalMs;
+  surveyCount = 0;
+  nextSurveyTime = millis();  // First sweep right away
+  surveyAwakeUntil = 0;
+  singleFreqMode = false;
+  setStatus("Survey mode");
+
+  // Blank the panel; it stays off until survey mode ends
+  u8g2.setPowerSave(1);
+
+  // Any serial input wakes the MCU from light sleep
+  uart_set_wakeup_threshold(UART_NUM_0, 3);
+  esp_sleep_enable_uart_wakeup(UART_NUM_0);
+
+  Serial.println("Survey mode: one sweep every " + String(intervalMs / 1000.0, 1) + " s");
+  Serial.println("Send any line to wake, then 'nosurvey' within " +
+                 String(SURVEY_WAKE_WINDOW_MS / 1000) + " s to leave survey mode");
+}
+
+void startReplay(const String& source, bool fast) {
+  stopReplay();
+  replayFromSerial = source == "serial";
+  if (!replayFromSerial) {
+    if (!LittleFS.begin()) {
+      Serial.println("Replay: LittleFS mount failed");
+      return;
+    }
+    String path = source.startsWith("/") ? source : "/" + source;
+    replayFile = LittleFS.open(path.c_str(), "r");
+    if (!replayFile || !replay.open(replayInput)) {
+      if (replayFile) replayFile.close();
+      Serial.println("Replay: no JSON or binary capture in " + path);
+      return;
+    }
+  }
+
+  replaySavedBegin = sweepBegin;
+  replaySavedEnd = sweepEnd;
+  replaySavedBins = freqSteps;
+  replaySavedAdaptive = adaptiveMode;
+  adaptiveMode = false;
+  singleFreqMode = false;
+
+  replayMode = fast ? REPLAY_FAST : REPLAY_REALTIME;
+  replayPending = false;
+  replayLoaded = false;
+  replaySweeps = 0;
+  replayStartMs = millis();
+  currentStep = 0;
+  spectrumRadio.setSource(replayRSSI);
+  setStatus(fast ? "Replay (fast)" : "Replay");
+  Serial.println("Replaying " + source + (fast ? " as fast as possible" : " in real time") +
+                 " - 'noreplay' to stop");
+}
+
+void stopReplay() {
+  if (replayMode == REPLAY_OFF) return;
+  unsigned long elapsed = millis() - replayStartMs;
+  Serial.println("Replay: " + String(replaySweeps) + " sweeps in " + String(elapsed) + " ms (" +
+                 String(elapsed ? replaySweeps * 1000.0 / elapsed : 0.0, 1) + " sweeps/s)");
+
+  replayMode = REPLAY_OFF;
+  replayFromSerial = false;
+  spectrumRadio.setSource(nullptr);
+  replay.close();
+  if (replayFile) replayFile.close();
+
+  // Back to the live plan; replayed data does not belong to it
+  sweepBegin = replaySavedBegin;
+  sweepEnd = replaySavedEnd;
+  adaptiveMode = replaySavedAdaptive;
+  setSweepBins(replaySavedBins);
+  setStatus(adaptiveMode ? "Adaptive scan" : "Scanning...");
+}
+
+// Whole recorded sweeps per pass: one when due in real time, as many as fit
+// in REPLAY_BATCH_MS when fast. The radio source makes every step instant.
+void replayCycle() {
+  unsigned long batchStart = millis();
+  do {
+    if (!replayLoaded) {
+      if (!advanceReplay()) return;
+      replayLoaded = true;
+    }
+    if (replayMode == REPLAY_REALTIME &&
+        millis() - replayClockStart < replay.sweep().timestamp - replayFirstTimestamp) {
+      return;
+    }
+
+    do {
+      scanSpectrum();
+    } while (currentStep != 0);
+    replayLoaded = false;
+    replaySweeps++;
+  } while (replayMode == REPLAY_FAST && millis() - batchStart < REPLAY_BATCH_MS);
+}
+
+// Load the next recorded sweep and match the sweep plan to it; false while
+// nothing is available or when the capture has ended
+bool advanceReplay() {
+  if (replayFromSerial) {
+    if (!replayPending) return false;
+    replayPending = false;
+  } else if (!replay.next()) {
+    Serial.println("Replay: end of capture");
+    stopReplay();
+    return false;
+  }
+
+  const ReplaySweep& sweep = replay.sweep();
+  // A timestamp going backwards means the recording device rebooted
+  if (replay.sweeps() == 1 || sweep.timestamp < replayFirstTimestamp) {
+    replayFirstTimestamp = sweep.timestamp;
+    replayClockStart = millis();
+  }
+  if (sweep.bins != freqSteps || sweep.freqBegin != sweepBegin || sweep.freqEnd != sweepEnd) {
+    sweepBegin = sweep.freqBegin;
+    sweepEnd = sweep.freqEnd;
+    setSweepBins(sweep.bins);
+  }
+  return true;
+}
+
+float replayRSSI(float mhz) {
+  return replay.rssiAt(mhz);
+}
+
+void stopSurvey() {
+  if (!surveyMode) return;
+  surveyMode = false;
+  u8g2.setPowerSave(0);
+  radio.standby();
+  radio.startReceive();
+  currentStep = 0;
+  setStatus("Scanning...");
+  Serial.println("Survey mode off - continuous scanning");
+}
+
+// One pass of the survey schedule: sweep if due, otherwise light-sleep until
+// the next sweep unless the serial wake window is open.
+void surveyCycle() {
+  if ((long)(millis() - nextSurveyTime) >= 0) {
+    runSurveySweep();
+    nextSurveyTime += surveyInterval;
+    // Don't try to catch up on sweeps missed while awake for commands
+    if ((long)(millis() - nextSurveyTime) >= 0) {
+      nextSurveyTime = millis() + surveyInterval;
+    }
+  }
+
+  if ((long)(millis() - surveyAwakeUntil) < 0 || Serial.available()) {
+    return;  // Stay awake so commands can be typed
+  }
+
+  long sleepMs = (long)(nextSurveyTime - millis());
+  if (sleepMs <= 0) return;
+
+  radio.sleep();
+  logFlush();  // Light sleep stops the UART mid-byte otherwise
+  esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000ULL);
+  esp_light_sleep_start();
+
+  if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UART) {
+    surveyAwakeUntil = millis() + SURVEY_WAKE_WINDOW_MS;
+    Serial.println("Woken by serial input - awake for commands");
+  }
+}
+
+// Sweep every bin back to back, emit the result and account for the energy
+void runSurveySweep() {
+  unsigned long wakeMicros = micros();
+
+  radio.standby();  // Wake the SX1262 from warm sleep
+  sweepStartTime = millis();
+  for (int i = 0; i < freqSteps; i++) {
+    bool measured;
+    float rssi = getRSSIAtFrequency(binCenterFrequency(i), RSSI_SAMPLES, SETTLE_DELAY, &measured);
+    setBin(i, rssi);
+    recordBinVisit(i, rssi, measured);
+  }
+  lastSweepDuration = millis() - sweepStartTime;
+  printJsonSnapshot();
+  maybeSaveBaseline();
+
+  lastSurveyAwakeMs = (micros() - wakeMicros) / 1000;
+  surveyCount++;
+
+  // Energy per cycle: awake at SURVEY_AWAKE_MA, rest of the interval asleep
+  unsigned long sleepMs = surveyInterval > lastSurveyAwakeMs ? surveyInterval - lastSurveyAwakeMs : 0;
+  float chargeMAms = SURVEY_AWAKE_MA * lastSurveyAwakeMs + SURVEY_SLEEP_MA * sleepMs;
+  lastSurveyEnergy = SURVEY_SUPPLY_VOLTAGE * chargeMAms / 1000.0;  // mJ
+  float averageMA = chargeMAms / surveyInterval;
+
+  LOG_INFO("Survey #%lu: awake %lu ms, %.1f mJ/sweep, avg %.2f mA (%.0f mAh/day)",
+           surveyCount, lastSurveyAwakeMs, lastSurveyEnergy, averageMA, averageMA * 24.0);
+}
+
+void startStream(float frequency) {
+  streamFreq = frequency;
+  singleFreqMode = false;
+
+  spectrumRadio.tune(frequency);
+  delay(SETTLE_DELAY);  // Settle once; the frequency never changes while streaming
+
+  memset(&streamStats, 0, sizeof(streamStats));
+  streamStats.minBurstUs = 0xFFFFFFFF;
+  streamStats.minInterArrivalUs = 0xFFFFFFFF;
+  streamHead = 0;
+  streamTail = 0;
+  streamOverflows = 0;
+  streamBlocks = 0;
+  lastStreamReport = millis();
+  lastReportSamples = 0;
+
+  streamRunning = true;
+  streamMode = true;
+  xTaskCreatePinnedToCore(streamTask, "rssiStream", 4096, NULL, 2, &streamTaskHandle, 0);
+
+  setStatus("Stream: %.1f MHz", frequency);
+  Serial.println("Streaming RSSI at " + String(frequency, 3) + " MHz - any command stops");
+}
+
+void stopStream() {
+  if (!streamMode) return;
+  streamRunning = false;
+  while (streamTaskHandle != NULL) {
+    delay(1);
+  }
+  streamMode = false;
+  setStatus("Stream stopped");
+
+  BurstStats stats = streamStats;
+  printStreamStats(stats);
+  Serial.println("Streaming stopped, " + String(streamBlocks) + " blocks sent, " +
+                 String(streamOverflows) + " samples not streamed");
+}
+
+// Sample instantaneous RSSI in raw SPI bursts and track bursts as samples
+// arrive. Every STREAM_YIELD_MS the task sleeps one tick, which leaves a gap
+// in the samples (visible in their timestamps) but lets WiFi, the log drain
+// and the idle task's watchdog feed run on core 0.
+void streamTask(void* param) {
+  bool inBurst = false;
+  uint32_t burstStart = 0;
+  uint32_t lastBurstStart = 0;
+  bool haveLastBurst = false;
+  float floor = 0.0;  // 0 dBm marks "not yet measured"
+  float block[spectrum::BURST_MAX_SAMPLES];
+  uint32_t stamps[spectrum::BURST_MAX_SAMPLES];  // When each valid reading was taken
+  uint32_t lastYield = millis();
+
+  while (streamRunning) {
+    // Rejected readings leave holes, so each sample keeps its own time
+    int valid = spectrumRadio.readRSSIBlock(block, spectrum::BURST_MAX_SAMPLES, 0, stamps);
+
+    for (int i = 0; i < valid; i++) {
+      float rssi = block[i];
+      uint32_t us = stamps[i];
+
+      uint32_t head = streamHead;
+      if (head - streamTail < STREAM_RING_SIZE) {
+        streamRing[head & (STREAM_RING_SIZE - 1)] = {us, (int16_t)lroundf(rssi * 2.0)};
+        streamHead = head + 1;
+      } else {
+        streamOverflows++;
+      }
+
+      if (floor == 0.0) floor = rssi;
+      float startLevel = floor + STREAM_BURST_MARGIN;
+
+      portENTER_CRITICAL(&streamLock);
+      if (streamStats.samples == 0) streamStats.startUs = us;
+      streamStats.samples++;
+      streamStats.lastUs = us;
+      streamStats.lastRSSI = rssi;
+
+      if (!inBurst && rssi > startLevel) {
+        inBurst = true;
+        burstStart = us;
+        streamStats.bursts++;
+        if (haveLastBurst) {
+          uint32_t interArrival = us - lastBurstStart;
+          streamStats.interArrivalSumUs += interArrival;
+          if (interArrival < streamStats.minInterArrivalUs) streamStats.minInterArrivalUs = interArrival;
+          if (interArrival > streamStats.maxInterArrivalUs) streamStats.maxInterArrivalUs = interArrival;
+        }
+        lastBurstStart = us;
+        haveLastBurst = true;
+      } else if (inBurst && rssi < startLevel - STREAM_BURST_HYSTERESIS) {
+        inBurst = false;
+        uint32_t length = us - burstStart;
+        streamStats.closedBursts++;
+        streamStats.busyUs += length;
+        if (length < streamStats.minBurstUs) streamStats.minBurstUs = length;
+        if (length > streamStats.maxBurstUs) streamStats.maxBurstUs = length;
+      }
+      streamStats.noiseFloor = floor;
+      portEXIT_CRITICAL(&streamLock);
+
+      // Only quiet samples move the floor, slowly
+      if (!inBurst) floor += (rssi - floor) / 256.0;
+    }
+
+    if (millis() - lastYield >= STREAM_YIELD_MS) {
+      vTaskDelay(1);
+      lastYield = millis();
+    }
+  }
+
+  streamTaskHandle = NULL;
+  vTaskDelete(NULL);
+}
+
+// Emit full blocks while the UART has room; report statistics periodically.
+// Block line: {"type":"rssiBlock","freq":..,"seq":..,"t0":us,"n":N,"samples":base64}
+// where each sample packs uint16 LE microseconds since the previous sample
+// (t0 for the first) and uint8 -2*RSSI.
+void streamOutput() {
+  static uint8_t packed[STREAM_BLOCK_SAMPLES * 3];
+  static char line[128 + STREAM_BLOCK_SAMPLES * 4];
+
+  while (streamHead - streamTail >= STREAM_BLOCK_SAMPLES) {
+    if (Serial.availableForWrite() < (int)sizeof(line)) break;
+
+    uint32_t tail = streamTail;
+    uint32_t t0 = streamRing[tail & (STREAM_RING_SIZE - 1)].us;
+    uint32_t prev = t0;
+    for (int i = 0; i < STREAM_BLOCK_SAMPLES; i++) {
+      const RssiSample& sample = streamRing[(tail + i) & (STREAM_RING_SIZE - 1)];
+      uint32_t delta = sample.us - prev;
+      if (delta > 0xFFFF) delta = 0xFFFF;
+      prev = sample.us;
+      int code = -sample.rssiQ;
+      packed[i * 3] = delta & 0xFF;
+      packed[i * 3 + 1] = delta >> 8;
+      packed[i * 3 + 2] = constrain(code, 0, 255);
+    }
+    streamTail = tail + STREAM_BLOCK_SAMPLES;
+
+    // Built as one line and written once so log output can't split it
+    int len = snprintf(line, sizeof(line),
+                       "{\"type\":\"rssiBlock\",\"freq\":%.3f,\"seq\":%lu,\"t0\":%lu,\"n\":%d,\"samples\":\"",
+                       streamFreq, (unsigned long)streamBlocks++, (unsigned long)t0, STREAM_BLOCK_SAMPLES);
+    size_t encodedLen = 0;
+    mbedtls_base64_encode((unsigned char*)line + len, sizeof(line) - len - 4, &encodedLen, packed, sizeof(packed));
+    len += encodedLen;
+    memcpy(line + len, "\"}\n", 3);
+    len += 3;
+    Serial.write((const uint8_t*)line, len);
+  }
+
+  unsigned long now = millis();
+  if (now - lastStreamReport >= STREAM_STATS_MS) {
+    BurstStats stats;
+    portENTER_CRITICAL(&streamLock);
+    stats = streamStats;
+    portEXIT_CRITICAL(&streamLock);
+
+    setBin(0, stats.lastRSSI);
+    LOG_INFO("Stream: %lu samples/s, %lu overflows",
+             (unsigned long)((stats.samples - lastReportSamples) * 1000UL / (now - lastStreamReport)),
+             (unsigned long)streamOverflows);
+    printStreamStats(stats);
+    lastReportSamples = stats.samples;
+    lastStreamReport = now;
+  }
+}
+
+void printStreamStats(const BurstStats& stats) {
+  uint32_t elapsedUs = stats.lastUs - stats.startUs;
+  float duty = elapsedUs > 0 ? (float)stats.busyUs / elapsedUs * 100.0 : 0.0;
+  float meanBurst = stats.closedBursts > 0 ? (float)stats.busyUs / stats.closedBursts / 1000.0 : 0.0;
+  float meanGap = stats.bursts > 1 ? (float)stats.interArrivalSumUs / (stats.bursts - 1) / 1000.0 : 0.0;
+  LOG_INFO("Bursts: %lu, duty %.2f%%, length %.2f/%.2f/%.2f ms (min/mean/max), "
+           "inter-arrival %.1f/%.1f/%.1f ms, floor %.1f dBm",
+           (unsigned long)stats.bursts, duty,
+           stats.minBurstUs == 0xFFFFFFFF ? 0.0 : stats.minBurstUs / 1000.0, meanBurst, stats.maxBurstUs / 1000.0,
+           stats.minInterArrivalUs == 0xFFFFFFFF ? 0.0 : stats.minInterArrivalUs / 1000.0, meanGap,
+           stats.maxInterArrivalUs / 1000.0, stats.noiseFloor);
+}
+
+// Start the timer-paced sweep. The period is rounded down to whole
+// microseconds per bin, so every sweep takes exactly cadencePeriodUs.
+bool startCadence(unsigned long periodMs) {
+  stopCadence();
+  uint32_t slotUs = (uint32_t)(periodMs * 1000UL / freqSteps);
+  uint32_t binUs = SETTLE_DELAY * 1000UL + RSSI_SAMPLES * spectrumRadio.sampleIntervalUs() + CADENCE_MARGIN_US;
+  if (slotUs < binUs) {
+    Serial.println("Cadence too fast: " + String(freqSteps) + " bins need at least " +
+                   String((binUs * freqSteps + 999) / 1000) + " ms per sweep");
+    return false;
+  }
+  if (captureState != CAPTURE_OFF && captureDwellSamples > 0) {
+    Serial.println("A dwell capture needs the radio; use 'capture <pre> <post>' with cadence");
+    return false;
+  }
+  // The timer gives every bin the same slot; adaptive dwell and watch revisits don't fit it
+  if (adaptiveMode) {
+    Serial.println("Cadence paces the plain sweep; turn adaptive off first ('noadaptive')");
+    return false;
+  }
+  if (watchSegments() > 0) {
+    Serial.println("Cadence paces the plain sweep; clear the watch list first ('unwatch')");
+    return false;
+  }
+
+  cadenceRequestMs = periodMs;
+  cadenceBins = freqSteps;
+  cadenceSlotUs = slotUs;
+  cadencePeriodUs = slotUs * freqSteps;
+  cadenceTicks = 0;
+  cadenceDoneReady = false;
+  cadenceSweeps = 0;
+  cadenceBinsLate = 0;
+  cadenceBinsMissed = 0;
+  cadenceSweepsLate = 0;
+  cadenceOverrunCount = 0;
+  cadenceOverrunsReported = 0;
+  for (int i = 0; i < freqSteps; i++) {
+    cadenceWork[i] = spectrumData[i];  // A missed bin keeps its previous reading
+    cadenceWorkMeasured[i] = false;    // ...but it isn't counted as a new one
+  }
+
+  cadenceRunning = true;
+  cadenceMode = true;
+  xTaskCreatePinnedToCore(cadenceTask, "cadence", 4096, NULL, 2, &cadenceTaskHandle, 0);
+
+  // 80 MHz APB / 80 = 1 us per timer count
+  cadenceTimer = timerBegin(CADENCE_TIMER, 80, true);
+  timerAttachInterrupt(cadenceTimer, &onCadenceTimer, true);
+  timerAlarmWrite(cadenceTimer, cadenceSlotUs, true);
+  timerAlarmEnable(cadenceTimer);
+
+  setStatus("Cadence %lu ms", periodMs);
+  Serial.println("Cadence: one sweep every " + String(cadencePeriodUs / 1000.0, 3) + " ms, " +
+                 String(cadenceBins) + " bins of " + String(cadenceSlotUs) + " us, " +
+                 String(100.0 * binUs / slotUs, 0) + "% of each slot on the radio");
+  return true;
+}
+
+void stopCadence() {
+  if (!cadenceMode) return;
+  timerAlarmDisable(cadenceTimer);
+  timerDetachInterrupt(cadenceTimer);
+  timerEnd(cadenceTimer);
+  cadenceTimer = NULL;
+  cadenceRunning = false;
+  while (cadenceTaskHandle != NULL) {
+    delay(1);
+  }
+  cadenceMode = false;
+  currentStep = 0;
+}
+
+// Status queries and display-only commands leave the timer running
+bool cadenceKeepsRunning(const String& command) {
+  return command == "help" || command == "info" || command == "heap" || command == "plan" ||
+         command == "watch" || command == "trigger" || command == "occ" || command == "baseline" ||
+         command == "unzoom" || command.startsWith("cadence") || command == "nocadence" ||
+         command.startsWith("log ") || command.startsWith("occ ") || command.startsWith("zoom ") ||
+         command.startsWith("span ");
+}
+
+void IRAM_ATTR onCadenceTimer() {
+  if (cadenceTicks == 0) cadenceStartUs = esp_timer_get_time();
+  cadenceTicks++;
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(cadenceTaskHandle, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+// One bin per timer slot. Slots that started while the previous bin was still
+// being read are missed; a read that ends after its slot is late.
+void cadenceTask(void* param) {
+  uint32_t slot = 0;           // Next slot to handle
+  uint16_t sweepOverruns = 0;  // Late or missed bins in the running sweep
+
+  while (cadenceRunning) {
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100)) == 0) continue;
+
+    uint32_t ticks = cadenceTicks;
+    while (slot + 1 < ticks) {
+      recordCadenceOverrun(OVERRUN_BIN_MISSED, slot, 0);
+      cadenceWorkMeasured[slot % cadenceBins] = false;
+      sweepOverruns++;
+      cadenceSlotDone(slot++, sweepOverruns);
+    }
+
+    int bin = slot % cadenceBins;
+    cadenceWork[bin] = getRSSIAtFrequency(binCenterFrequency(bin), RSSI_SAMPLES, SETTLE_DELAY,
+                                          &cadenceWorkMeasured[bin]);
+    int64_t late = esp_timer_get_time() - (cadenceStartUs + (int64_t)(slot + 1) * cadenceSlotUs);
+    if (late > 0) {
+      recordCadenceOverrun(OVERRUN_BIN_LATE, slot, (uint32_t)late);
+      sweepOverruns++;
+    }
+    cadenceSlotDone(slot++, sweepOverruns);
+  }
+
+  cadenceTaskHandle = NULL;
+  vTaskDelete(NULL);
+}
+
+// After the last bin of a sweep, hand it to loop(); one it never took is lost
+void cadenceSlotDone(uint32_t slot, uint16_t& sweepOverruns) {
+  if ((slot + 1) % cadenceBins != 0) return;
+
+  portENTER_CRITICAL(&cadenceLock);
+  bool notTaken = cadenceDoneReady;
+  memcpy(cadenceDone, cadenceWork, cadenceBins * sizeof(float));
+  memcpy(cadenceDoneMeasured, cadenceWorkMeasured, cadenceBins * sizeof(bool));
+  cadenceDoneReady = true;
+  cadenceDoneSweep = slot / cadenceBins;
+  cadenceDoneOverruns = sweepOverruns;
+  cadenceSweeps++;
+  portEXIT_CRITICAL(&cadenceLock);
+
+  if (notTaken) recordCadenceOverrun(OVERRUN_SWEEP_LATE, slot, 0);
+  sweepOverruns = 0;
+}
+
+void recordCadenceOverrun(CadenceOverrunKind kind, uint32_t slot, uint32_t lateUs) {
+  portENTER_CRITICAL(&cadenceLock);
+  CadenceOverrun& entry = cadenceOverruns[cadenceOverrunCount % CADENCE_OVERRUN_LOG];
+  entry.ms = millis();
+  entry.sweep = slot / cadenceBins;
+  entry.bin = kind == OVERRUN_SWEEP_LATE ? -1 : slot % cadenceBins;
+  entry.kind = kind;
+  entry.lateUs = lateUs;
+  cadenceOverrunCount++;
+  if (kind == OVERRUN_BIN_LATE) cadenceBinsLate++;
+  else if (kind == OVERRUN_BIN_MISSED) cadenceBinsMissed++;
+  else cadenceSweepsLate++;
+  portEXIT_CRITICAL(&cadenceLock);
+}
+
+// Finished sweeps go through the normal path, stamped with their scheduled
+// start so consecutive sweeps are exactly one period apart
+void cadenceOutput() {
+  portENTER_CRITICAL(&cadenceLock);
+  bool ready = cadenceDoneReady;
+  uint32_t sweep = cadenceDoneSweep;
+  uint16_t overruns = cadenceDoneOverruns;
+  if (ready) {
+    memcpy(cadenceSweep, cadenceDone, cadenceBins * sizeof(float));
+    memcpy(cadenceSweepMeasured, cadenceDoneMeasured, cadenceBins * sizeof(bool));
+    cadenceDoneReady = false;
+  }
+  uint32_t recorded = cadenceOverrunCount;
+  portEXIT_CRITICAL(&cadenceLock);
+  if (!ready) return;
+
+  for (int i = 0; i < cadenceBins; i++) {
+    setBin(i, cadenceSweep[i]);
+    recordBinVisit(i, cadenceSweep[i], cadenceSweepMeasured[i]);
+  }
+  currentStep = 0;
+  sweepStartTime = (unsigned long)((cadenceStartUs + (int64_t)sweep * cadencePeriodUs) / 1000);
+  lastSweepDuration = cadencePeriodUs / 1000;
+  cadenceLastOverruns = overruns;
+  printJsonSnapshot();
+  maybeSaveBaseline();
+
+  if (recorded != cadenceOverrunsReported) {
+    LOG_WARN("Cadence: %lu new overruns, %u late or missed bins in sweep %lu",
+             (unsigned long)(recorded - cadenceOverrunsReported), overruns, (unsigned long)sweep);
+    cadenceOverrunsReported = recorded;
+  }
+}
+
+void printCadenceInfo() {
+  if (!cadenceMode) {
+    Serial.println("Cadence: off");
+    return;
+  }
+  static const char* const KIND_NAMES[] = {"bin late", "bin missed", "sweep not taken"};
+  CadenceOverrun recent[CADENCE_OVERRUN_LOG];
+  portENTER_CRITICAL(&cadenceLock);
+  uint32_t count = cadenceOverrunCount;
+  uint32_t sweeps = cadenceSweeps, late = cadenceBinsLate, missed = cadenceBinsMissed, lost = cadenceSweepsLate;
+  memcpy(recent, cadenceOverruns, sizeof(recent));
+  portEXIT_CRITICAL(&cadenceLock);
+
+  Serial.println("Cadence: " + String(cadencePeriodUs / 1000.0, 3) + " ms per sweep, " + String(cadenceBins) +
+                 " bins of " + String(cadenceSlotUs) + " us, " + String(sweeps) + " sweeps");
+  Serial.println("  Overruns: " + String(late) + " bins late, " + String(missed) + " bins missed, " +
+                 String(lost) + " sweeps not taken by loop()");
+  uint32_t first = count > CADENCE_OVERRUN_LOG ? count - CADENCE_OVERRUN_LOG : 0;
+  for (uint32_t i = first; i < count; i++) {
+    const CadenceOverrun& o = recent[i % CADENCE_OVERRUN_LOG];
+    Serial.println("  " + String(o.ms) + " ms: sweep " + String(o.sweep) +
+                   (o.bin >= 0 ? ", bin " + String(o.bin) : String("")) + ", " + KIND_NAMES[o.kind] +
+                   (o.lateUs > 0 ? " by " + String(o.lateUs) + " us" : String("")));
+  }
+}
+
 void monitorSingleFrequency() {
   // Monitor a single frequency continuously
   float rssi = getRSSIAtFrequency(singleFreq);
   
   // Update display data (use first bin for single frequency)
-  spectrumData[0] = rssi;
-  
-  // Update min/max for scaling
-  if (rssi > maxRSSI) maxRSSI = rssi;
-  if (rssi < minRSSI) minRSSI = rssi;
+  setBin(0, rssi);
   
   // Print to serial every 10 readings
   static int readingCount = 0;
   readingCount++;
   if (readingCount >= 10) {
-    Serial.print("Freq: "); Serial.print(singleFreq, 1);
-    Serial.print(" MHz, RSSI: "); Serial.print(rssi, 1); Serial.println(" dBm");
+    LOG_DEBUG("Freq: %.1f MHz, RSSI: %.1f dBm", singleFreq, rssi);
     readingCount = 0;
   }
 }
@@ -389,7 +2208,7 @@ void updateDisplay() {
   
   // Status information
   u8g2.setFont(u8g2_font_ncenR08_tr);
-  u8g2.drawStr(0, DISPLAY_HEIGHT - 2, statusMessage.c_str());
+  u8g2.drawStr(0, DISPLAY_HEIGHT - 2, statusMessage);
   
   // Show test mode indicator
   if (testMode) {
@@ -397,52 +2216,456 @@ void updateDisplay() {
   }
   
   // Frequency range
-  String freqRange = String(FREQ_BEGIN, 0) + "-" + String(FREQ_END, 0) + " MHz";
-  u8g2.drawStr(DISPLAY_WIDTH - u8g2.getStrWidth(freqRange.c_str()), DISPLAY_HEIGHT - 2, freqRange.c_str());
+  if (updateLabel(labelRange, lroundf(binFrequency(zoomFirst)), lroundf(binFrequency(zoomFirst + zoomCount)),
+                  "%d-%d MHz")) {
+    labelRange.width = u8g2.getStrWidth(labelRange.text);
+  }
+  u8g2.drawStr(DISPLAY_WIDTH - labelRange.width, DISPLAY_HEIGHT - 2, labelRange.text);
   
   u8g2.sendBuffer();
 }
 
+void setStatus(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  vsnprintf(statusMessage, sizeof(statusMessage), format, args);
+  va_end(args);
+}
+
+// Reformat a label if the values it shows changed; true when it did
+bool updateLabel(DisplayLabel& label, int a, int b, const char* format) {
+  if (label.valid && label.a == a && label.b == b) return false;
+  snprintf(label.text, sizeof(label.text), format, a, b);
+  label.a = a;
+  label.b = b;
+  label.valid = true;
+  return true;
+}
+
+void printHeapInfo() {
+  Serial.println("Heap: " + String(ESP.getFreeHeap()) + " bytes free, " + String(ESP.getMinFreeHeap()) +
+                 " minimum, largest block " + String(ESP.getMaxAllocHeap()));
+#ifdef HEAP_COUNT_ALLOCS
+  Serial.println("Allocations: " + String(loopAllocsLast) + " last loop() pass, " + String(loopAllocsMax) +
+                 " max, " + String(renderAllocs) + " in the display path over " + String(loopPasses) + " passes");
+#else
+  Serial.println("Allocations: not counted, build the heapcount environment");
+#endif
+}
+
 // Emit JSON payload for PC bridge (MQTT/HTTP forwarder)
 void printJsonSnapshot() {
-  StaticJsonDocument<4096> doc;
-  doc["timestamp"] = millis();
+  if (firstSweepMs == 0) {
+    firstSweepMs = millis();
+    LOG_INFO("Time to first sweep: %lu ms (setup %lu ms)", firstSweepMs, setupDoneMs);
+  }
+  sweepSeq++;
+
+  // With a trigger armed, sweeps only go out inside a captured window
+  if (captureState != CAPTURE_OFF) {
+    captureSweepDone();
+    return;
+  }
+  printSweepJson(nullptr, 0);
+}
+
+// One sweep line: the live data, or a stored sweep tagged with the capture
+// it belongs to. Captured sweeps keep their original time and sequence number.
+void printSweepJson(const CapturedSweep* row, int index) {
+  // Sized for the active resolution; 1024 bins need far more than the 64-bin default
+  size_t capacity = JSON_OBJECT_SIZE(12) + JSON_ARRAY_SIZE(freqSteps) + freqSteps * JSON_OBJECT_SIZE(2);
+  if (row) capacity += JSON_OBJECT_SIZE(2);
+  DynamicJsonDocument doc(capacity);
+  if (doc.capacity() == 0) {
+    LOG_ERROR("Snapshot: no heap for %u-byte JSON document", (unsigned)capacity);
+    return;
+  }
+  doc["timestamp"] = row ? row->timestamp : millis();
   doc["deviceId"] = "heltec-v3";
-  doc["freqBegin"] = FREQ_BEGIN;
-  doc["freqEnd"] = FREQ_END;
-  doc["freqSteps"] = FREQ_STEPS;
+  // Sequence and sweep window let the bridge, API and page trace latency
+  doc["seq"] = row ? row->seq : sweepSeq;
+  doc["sweepStart"] = row ? row->start : sweepStartTime;
+  doc["sweepEnd"] = row ? row->start + row->duration : sweepStartTime + lastSweepDuration;
+  doc["freqBegin"] = sweepBegin;
+  doc["freqEnd"] = sweepEnd;
+  doc["freqSteps"] = freqSteps;
+  doc["rxBandwidth"] = rxBandwidth;
+  if (cadenceMode && !row) {
+    doc["overruns"] = cadenceLastOverruns;  // Late or missed bins in this sweep
+  }
 
   JsonArray data = doc.createNestedArray("data");
-  for (int i = 0; i < FREQ_STEPS; i++) {
+  for (int i = 0; i < freqSteps; i++) {
     JsonObject point = data.createNestedObject();
-    float freq = FREQ_BEGIN + (i * (FREQ_END - FREQ_BEGIN) / FREQ_STEPS);
+    float freq = binCenterFrequency(i);
     point["freq"] = freq;
-    point["rssi"] = spectrumData[i];
+    point["rssi"] = row ? row->rssi[i] / 10.0 : spectrumData[i];
+  }
+
+  if (row) {
+    JsonObject capture = doc.createNestedObject("capture");
+    capture["id"] = captureId;
+    capture["index"] = index;
+  }
+
+  if (doc.overflowed()) {
+    LOG_ERROR("Snapshot: JSON document full at %u bytes, sweep not sent", (unsigned)capacity);
+    return;
+  }
+
+  // One write for the whole line so log output from the drain task can't split it
+  String out;
+  if (!out.reserve(measureJson(doc) + 1)) {
+    LOG_ERROR("Snapshot: no heap for %u-byte line", (unsigned)measureJson(doc) + 1);
+    return;
+  }
+  serializeJson(doc, out);
+  out += '\n';
+  // Fast file replay encodes every sweep but only prints a sample of them
+  if (!row && replayMode == REPLAY_FAST && !replayFromSerial) {
+    if (millis() - replayLastPrint < REPLAY_PRINT_MS) return;
+    replayLastPrint = millis();
+  }
+  Serial.print(out);
+
+  // Occupancy windows only change every 10 s; they follow the snapshot when they do
+  if (occupancyReportPending) {
+    printOccupancyJson();
+    occupancyReportPending = false;
+  }
+}
+
+// Size the sweep ring for the active resolution and wait for the trigger.
+// A capture in progress is dropped.
+bool armCapture() {
+  int rows = capturePre + (captureDwellSamples > 0 ? 0 : capturePost);
+  if (!captureReset(freqSteps, max(rows, 1))) return false;
+  triggerRearm();
+  captureSampleCount = 0;
+  captureState = CAPTURE_ARMED;
+  return true;
+}
+
+void disarmCapture() {
+  captureState = CAPTURE_OFF;
+  captureSampleCount = 0;
+}
+
+// Called on the reading that completes the trigger condition
+void fireTrigger(int bin, float rssi) {
+  captureId++;
+  captureTriggerMs = millis();
+  captureTriggerFreq = binCenterFrequency(bin);
+  captureTriggerRSSI = rssi;
+  LOG_INFO("Trigger #%lu: %.1f dBm at %.3f MHz", captureId, rssi, captureTriggerFreq);
+
+  if (captureDwellSamples > 0) {
+    // The rest of this sweep is dropped; loop() samples this frequency next
+    captureState = CAPTURE_DWELL;
+    captureSampleCount = 0;
+    setStatus("Capture %.1f", captureTriggerFreq);
+  } else {
+    // The sweep that fired is the first post-trigger sweep
+    captureState = CAPTURE_POST;
+    capturePostLeft = capturePost;
+    setStatus("Capture #%lu", captureId);
+  }
+}
+
+// End of a sweep while a trigger is set: keep it in the ring, and send the
+// window once the post-trigger sweeps are in
+void captureSweepDone() {
+  if (captureState == CAPTURE_DWELL) return;  // Partial sweep, superseded by the dwell
+  if (captureState == CAPTURE_ARMED) triggerSweepDone();
+
+  captureStore(spectrumData, millis(), sweepSeq, sweepStartTime, lastSweepDuration);
+  if (captureState == CAPTURE_POST && --capturePostLeft <= 0) {
+    emitCapture();
+    armCapture();
+    setStatus("Trigger armed");
   }
+}
+
+// Back-to-back RSSI readings at the trigger frequency, in batches of
+// CAPTURE_DWELL_BATCH_MS; sends the capture when all samples are in
+void captureDwell() {
+  if (captureSampleCount == 0) {
+    spectrumRadio.tune(captureTriggerFreq);
+    delay(SETTLE_DELAY);
+  }
+
+  unsigned long batchStart = millis();
+  while (captureSampleCount < captureDwellSamples && millis() - batchStart < CAPTURE_DWELL_BATCH_MS) {
+    float rssi;
+    if (!spectrumRadio.readRSSI(rssi, 1, 0)) continue;
+    captureSamples[captureSampleCount++] = {(uint32_t)micros(), (int16_t)lroundf(rssi * 2.0)};
+  }
+  if (captureSampleCount < captureDwellSamples) return;
+
+  emitCapture();
+  armCapture();
+  currentStep = 0;  // Start a fresh sweep
+  setStatus("Trigger armed");
+}
+
+// Capture line: {"type":"capture","id","triggerMs","freq","rssi","condition":{...},
+// "sweeps","samples"}, then the stored sweeps as regular sweep lines with a
+// "capture" tag, then the dwell samples as captureBlock lines
+void emitCapture() {
+  const TriggerCondition& condition = triggerCondition();
+  StaticJsonDocument<384> doc;
+  doc["type"] = "capture";
+  doc["id"] = captureId;
+  doc["triggerMs"] = captureTriggerMs;
+  doc["freq"] = captureTriggerFreq;
+  doc["rssi"] = captureTriggerRSSI;
+  JsonObject trigger = doc.createNestedObject("condition");
+  trigger["begin"] = condition.beginMHz;
+  trigger["end"] = condition.endMHz;
+  trigger["threshold"] = condition.thresholdDbm;
+  trigger["hits"] = condition.hits;
+  doc["sweeps"] = captureStored();
+  doc["samples"] = captureSampleCount;
 
   String out;
   serializeJson(doc, out);
-  Serial.println(out);
+  out += '\n';
+  Serial.print(out);
+
+  for (int i = 0; i < captureStored(); i++) {
+    CapturedSweep row = captureRow(i);
+    printSweepJson(&row, i);
+  }
+  printCaptureSamples();
+  LOG_INFO("Capture #%lu sent: %d sweeps, %d samples", captureId, captureStored(), captureSampleCount);
+}
+
+// Dwell samples packed like the stream's rssiBlock lines (see streamOutput())
+void printCaptureSamples() {
+  static uint8_t packed[STREAM_BLOCK_SAMPLES * 3];
+  static char line[160 + STREAM_BLOCK_SAMPLES * 4];
+
+  for (int first = 0, seq = 0; first < captureSampleCount; first += STREAM_BLOCK_SAMPLES, seq++) {
+    int n = min(STREAM_BLOCK_SAMPLES, captureSampleCount - first);
+    uint32_t t0 = captureSamples[first].us;
+    uint32_t prev = t0;
+    for (int i = 0; i < n; i++) {
+      const RssiSample& sample = captureSamples[first + i];
+      uint32_t delta = sample.us - prev;
+      if (delta > 0xFFFF) delta = 0xFFFF;
+      prev = sample.us;
+      int code = -sample.rssiQ;
+      packed[i * 3] = delta & 0xFF;
+      packed[i * 3 + 1] = delta >> 8;
+      packed[i * 3 + 2] = constrain(code, 0, 255);
+    }
+
+    int len = snprintf(line, sizeof(line),
+                       "{\"type\":\"captureBlock\",\"id\":%lu,\"freq\":%.3f,\"seq\":%d,\"t0\":%lu,\"n\":%d,\"samples\":\"",
+                       captureId, captureTriggerFreq, seq, (unsigned long)t0, n);
+    size_t encodedLen = 0;
+    mbedtls_base64_encode((unsigned char*)line + len, sizeof(line) - len - 4, &encodedLen, packed, n * 3);
+    len += encodedLen;
+    memcpy(line + len, "\"}\n", 3);
+    len += 3;
+    Serial.write((const uint8_t*)line, len);
+  }
+}
+
+void printCaptureInfo() {
+  if (captureState == CAPTURE_OFF) {
+    Serial.println("Trigger: off");
+  } else {
+    const TriggerCondition& condition = triggerCondition();
+    Serial.println("Trigger: above " + String(condition.thresholdDbm, 1) + " dBm in " +
+                   String(condition.beginMHz, 2) + " - " + String(condition.endMHz, 2) + " MHz on " +
+                   String(condition.hits) + " consecutive sweep(s), " + String(captureId) + " captures");
+  }
+  String after = captureDwellSamples > 0 ? String(captureDwellSamples) + " samples at the trigger frequency"
+                                         : String(capturePost) + " sweeps from the trigger on";
+  Serial.println("Capture: " + String(capturePre) + " sweeps before, then " + after);
+}
+
+// Per-visit statistics: occupancy, the baseline unless the data is simulated,
+// and the capture trigger. A stand-in value from a failed read is only displayed.
+void recordBinVisit(int bin, float rssi, bool measured) {
+  if (!measured) return;
+  if (occupancyVisit(bin, rssi, millis())) {
+    occupancyReportPending = true;
+  }
+  if (!testMode && replayMode == REPLAY_OFF) baselineUpdate(bin, rssi);
+  if (captureState == CAPTURE_ARMED && triggerVisit(binCenterFrequency(bin), rssi)) {
+    fireTrigger(bin, rssi);
+  }
+}
+
+// Start every bin at its learned floor, and the display scale at the floor's
+// range, or at the old fixed values for bins without a baseline yet
+void resetSpectrumData() {
+  maxRSSI = -200.0;
+  minRSSI = 0.0;
+  for (int i = 0; i < freqSteps; i++) {
+    if (!baselineTrained(i)) {
+      spectrumData[i] = -100.0;
+      continue;
+    }
+    float floor = baselineFloor(i);
+    float margin = BASELINE_SCALE_SPREADS * baselineSpread(i);
+    spectrumData[i] = floor;
+    if (floor + margin > maxRSSI) maxRSSI = floor + margin;
+    if (floor - margin < minRSSI) minRSSI = floor - margin;
+  }
+}
+
+void maybeSaveBaseline() {
+  if (millis() - lastBaselineSave < BASELINE_SAVE_INTERVAL) return;
+  lastBaselineSave = millis();
+  if (baselineSave()) {
+    LOG_INFO("Baseline saved (plan %08lx)", (unsigned long)baselinePlanKey());
+  }
+}
+
+void printBaselineInfo() {
+  int trained = baselineTrainedBins();
+  Serial.println("=== Noise Floor Baseline ===");
+  Serial.println("Plan key: " + String(baselinePlanKey(), HEX) + ", " + String(trained) + "/" +
+                 String(freqSteps) + " bins learned" + (baselineDirty() ? " (unsaved changes)" : ""));
+  if (trained == 0) return;
+
+  float lo = 0.0, hi = -200.0, spreadSum = 0.0;
+  for (int i = 0; i < freqSteps; i++) {
+    if (!baselineTrained(i)) continue;
+    lo = min(lo, baselineFloor(i));
+    hi = max(hi, baselineFloor(i));
+    spreadSum += baselineSpread(i);
+  }
+  Serial.println("Floor: " + String(lo, 1) + " to " + String(hi, 1) + " dBm, mean spread " +
+                 String(spreadSum / trained, 1) + " dB");
+}
+
+// One line per window and OCC_JSON_BINS-bin range, so the report never needs
+// more than a fixed document however many bins the sweep has:
+// {"type":"occupancy","report":n,"threshold":dBm,"window":w,"windows":3,"seconds","slots",
+//  "first":bin,"bins":total,"busy":[% per bin, -1 = no data],"bursts":[per bin],
+//  "dwellHist":[OCC_HIST_BUCKETS] (first chunk of a window only)}
+// The bridge joins the chunks back into one "occupancy" object for the API.
+void printOccupancyJson() {
+  static StaticJsonDocument<JSON_OBJECT_SIZE(13) + 2 * JSON_ARRAY_SIZE(OCC_JSON_BINS) +
+                           JSON_ARRAY_SIZE(OCC_HIST_BUCKETS)> doc;
+  static char line[OCC_JSON_LINE];
+  occupancyReports++;
+
+  for (int w = 0; w < OCC_WINDOWS; w++) {
+    for (int first = 0; first < freqSteps; first += OCC_JSON_BINS) {
+      doc.clear();
+      doc["type"] = "occupancy";
+      doc["report"] = occupancyReports;
+      doc["threshold"] = occupancyThreshold();
+      doc["window"] = w;
+      doc["windows"] = OCC_WINDOWS;
+      doc["seconds"] = OCC_WINDOW_SECONDS[w];
+      doc["slots"] = occupancySlotsFilled(w);
+      doc["first"] = first;
+      doc["bins"] = freqSteps;
+      JsonArray busy = doc.createNestedArray("busy");
+      JsonArray bursts = doc.createNestedArray("bursts");
+      int end = min(first + OCC_JSON_BINS, freqSteps);
+      for (int i = first; i < end; i++) {
+        int value = occupancyBusy(w, i);
+        busy.add(value < 0 ? -1.0 : round(value * 1000.0 / OCC_FULL_SCALE) / 10.0);  // 0.1 % steps
+        bursts.add(occupancyBursts(w, i));
+      }
+      if (first == 0) {
+        uint32_t histogram[OCC_HIST_BUCKETS];
+        occupancyHistogram(w, histogram);
+        JsonArray hist = doc.createNestedArray("dwellHist");
+        for (int h = 0; h < OCC_HIST_BUCKETS; h++) {
+          hist.add(histogram[h]);
+        }
+      }
+
+      // Written as one line for the same reason as the snapshot
+      size_t len = doc.overflowed() ? 0 : serializeJson(doc, line, sizeof(line) - 1);
+      if (len == 0 || len >= sizeof(line) - 2) {
+        LOG_ERROR("Occupancy report %lu: window %d bins %d+ did not fit, report dropped",
+                  (unsigned long)occupancyReports, w, first);
+        return;
+      }
+      line[len++] = '\n';
+      Serial.write((const uint8_t*)line, len);
+    }
+  }
+}
+
+void printOccupancyReport() {
+  const char* names[OCC_WINDOWS] = {"1 min", "10 min", "1 h"};
+  Serial.println("=== Channel Occupancy (threshold " + String(occupancyThreshold(), 1) + " dBm) ===");
+
+  for (int w = 0; w < OCC_WINDOWS; w++) {
+    if (occupancySlotsFilled(w) == 0) {
+      Serial.println(String(names[w]) + ": collecting...");
+      continue;
+    }
+
+    // Mean over bins plus the busiest few, found by repeated selection
+    long sum = 0;
+    int counted = 0;
+    int top[OCC_TOP_BINS];
+    int topCount = 0;
+    for (int i = 0; i < freqSteps; i++) {
+      int busy = occupancyBusy(w, i);
+      if (busy < 0) continue;
+      sum += busy;
+      counted++;
+      int pos = topCount < OCC_TOP_BINS ? topCount++ : OCC_TOP_BINS;
+      while (pos > 0 && occupancyBusy(w, top[pos - 1]) < busy) {
+        if (pos < OCC_TOP_BINS) top[pos] = top[pos - 1];
+        pos--;
+      }
+      if (pos < OCC_TOP_BINS) top[pos] = i;
+    }
+
+    Serial.println(String(names[w]) + " (" + String(occupancySlotsFilled(w)) + " slots): mean busy " +
+                   String(counted ? sum * 100.0 / OCC_FULL_SCALE / counted : 0.0, 1) + "%");
+    for (int t = 0; t < topCount; t++) {
+      int bin = top[t];
+      Serial.println("  " + String(binCenterFrequency(bin), 3) + " MHz: " +
+                     String(occupancyBusy(w, bin) * 100.0 / OCC_FULL_SCALE, 1) + "% busy, " +
+                     String(occupancyBursts(w, bin)) + " bursts");
+    }
+
+    uint32_t histogram[OCC_HIST_BUCKETS];
+    occupancyHistogram(w, histogram);
+    String line = "  Dwell:";
+    for (int h = 0; h < OCC_HIST_BUCKETS; h++) {
+      line += " " + String(occupancyBucketLabel(h)) + "=" + String(histogram[h]);
+    }
+    Serial.println(line);
+  }
 }
 
 void drawSpectrum() {
-  // Draw the spectrum bars
-  for (int i = 0; i < FREQ_STEPS; i++) {
-    // Calculate bar height based on RSSI value
-    float rssi = spectrumData[i];
-    float normalized = (rssi - minRSSI) / (maxRSSI - minRSSI);
-    if (maxRSSI == minRSSI) normalized = 0.5; // Avoid division by zero
-    
+  float range = maxRSSI - minRSSI;
+  int scanColumn = -1;
+  if (currentStep >= zoomFirst && currentStep < zoomFirst + zoomCount) {
+    scanColumn = (long)(currentStep - zoomFirst) * DISPLAY_COLUMNS / zoomCount;
+  }
+
+  // Draw one bar per display column, using the decimated min/max of its bins
+  for (int c = 0; c < DISPLAY_COLUMNS; c++) {
+    // Bar height follows the column maximum so narrow peaks survive decimation
+    float rssi = columnMax[c];
+    float normalized = range != 0.0 ? (rssi - minRSSI) / range : 0.5;
     int barHeight = (int)(normalized * GRAPH_HEIGHT);
     if (barHeight < 1) barHeight = 1;
     if (barHeight > GRAPH_HEIGHT) barHeight = GRAPH_HEIGHT;
     
-    // Draw vertical line for this frequency bin
-    int x = GRAPH_X_OFFSET + i * 2; // 2 pixels per frequency step
+    // Draw vertical line for this display column
+    int x = GRAPH_X_OFFSET + c * COLUMN_WIDTH;
     int y = GRAPH_Y_OFFSET + GRAPH_HEIGHT - barHeight;
     
     // Use different colors/intensities based on signal strength
-    if (rssi > -60.0) {
+    if (rssi > -60.0 && COLUMN_WIDTH > 1) {
       // Strong signal - draw thicker line
       u8g2.drawVLine(x, y, barHeight);
       if (x + 1 < DISPLAY_WIDTH) {
@@ -452,9 +2675,17 @@ void drawSpectrum() {
       // Weak signal - normal line
       u8g2.drawVLine(x, y, barHeight);
     }
+
+    // Notch the bar at the column minimum when the decimated bins disagree
+    int minHeight = range != 0.0 ? (int)((columnMin[c] - minRSSI) / range * GRAPH_HEIGHT) : 0;
+    if (minHeight >= 1 && minHeight < barHeight - 1) {
+      u8g2.setDrawColor(0);
+      u8g2.drawPixel(x, GRAPH_Y_OFFSET + GRAPH_HEIGHT - minHeight);
+      u8g2.setDrawColor(1);
+    }
     
     // Highlight current scanning position
-    if (i == currentStep) {
+    if (c == scanColumn) {
       u8g2.drawVLine(x, GRAPH_Y_OFFSET, GRAPH_HEIGHT);
     }
   }
@@ -471,20 +2702,21 @@ void drawAxes() {
   u8g2.setFont(u8g2_font_5x7_tr);
   
   // Start frequency
-  String startFreq = String(FREQ_BEGIN, 0);
-  u8g2.drawStr(GRAPH_X_OFFSET, GRAPH_Y_OFFSET + GRAPH_HEIGHT + 8, startFreq.c_str());
+  updateLabel(labelStart, lroundf(binFrequency(zoomFirst)), 0, "%d");
+  u8g2.drawStr(GRAPH_X_OFFSET, GRAPH_Y_OFFSET + GRAPH_HEIGHT + 8, labelStart.text);
   
   // End frequency
-  String endFreq = String(FREQ_END, 0);
-  int endFreqWidth = u8g2.getStrWidth(endFreq.c_str());
-  u8g2.drawStr(DISPLAY_WIDTH - endFreqWidth, GRAPH_Y_OFFSET + GRAPH_HEIGHT + 8, endFreq.c_str());
+  if (updateLabel(labelEnd, lroundf(binFrequency(zoomFirst + zoomCount)), 0, "%d")) {
+    labelEnd.width = u8g2.getStrWidth(labelEnd.text);
+  }
+  u8g2.drawStr(DISPLAY_WIDTH - labelEnd.width, GRAPH_Y_OFFSET + GRAPH_HEIGHT + 8, labelEnd.text);
   
   // RSSI scale on left
-  String maxRSSIStr = String(maxRSSI, 0);
-  u8g2.drawStr(0, GRAPH_Y_OFFSET + 6, maxRSSIStr.c_str());
+  updateLabel(labelMax, lroundf(maxRSSI), 0, "%d");
+  u8g2.drawStr(0, GRAPH_Y_OFFSET + 6, labelMax.text);
   
-  String minRSSIStr = String(minRSSI, 0);
-  u8g2.drawStr(0, GRAPH_Y_OFFSET + GRAPH_HEIGHT - 2, minRSSIStr.c_str());
+  updateLabel(labelMin, lroundf(minRSSI), 0, "%d");
+  u8g2.drawStr(0, GRAPH_Y_OFFSET + GRAPH_HEIGHT - 2, labelMin.text);
   
   // Title
   u8g2.setFont(u8g2_font_ncenB08_tr);
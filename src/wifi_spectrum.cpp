@@ -8,7 +8,9 @@
 #include <SPI.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include <WiFiUdp.h>
 #include <ArduinoJson.h>
+#include <spectrum_core.h>
 
 // WiFi credentials
 const char* WIFI_SSID = "Redmi";
@@ -17,83 +19,199 @@ const char* WIFI_PASSWORD = "davilindo";
 // API endpoint (your Vercel URL)
 const char* API_ENDPOINT = "https://automacao-industrial-ene-090-xwqc.vercel.app";
 
-// LoRa configuration (SX1262)
-#define LORA_NSS 8
-#define LORA_SCK 9
-#define LORA_MOSI 10
-#define LORA_MISO 11
-#define LORA_RST 12
-#define LORA_BUSY 13
-#define LORA_DIO1 14
-
-// OLED pins
-#define OLED_SDA 17
-#define OLED_SCL 18
-#define OLED_RST 21
-#define VEXT_CTRL 36
-
-// Spectrum analyzer configuration
-#define FREQ_BEGIN 400.0
-#define FREQ_END 960.0
-#define FREQ_STEPS 64
-#define SCAN_DELAY 100
+// LAN output: every sweep as UDP datagrams (tools/udp_listen.py), alongside the API posts
+const bool UDP_ENABLED = true;
+const IPAddress UDP_GROUP(239, 10, 0, 1);  // Multicast group, or the subnet broadcast address
+const uint16_t UDP_PORT = 5005;
+const int UDP_MAX_BINS = 512;              // Bins per datagram; 1024 bytes keeps it under the MTU
+
+// Spectrum analyzer configuration: the shared default sweep
+struct WifiSweep : spectrum::SweepConfig {};
+using Sweep = spectrum::SweepTable<WifiSweep>;
 
 // Initialize hardware
 U8G2_SSD1306_128X64_NONAME_F_HW_I2C u8g2(U8G2_R0, OLED_RST);
 SX1262 radio = new Module(LORA_NSS, LORA_DIO1, LORA_RST, LORA_BUSY);
+spectrum::SpectrumRadio spectrumRadio(radio);
 
 // Data storage
-float spectrumData[FREQ_STEPS];
+float spectrumData[WifiSweep::BINS];
 bool scanning = true;
 int currentStep = 0;
 unsigned long lastSendTime = 0;
+unsigned long sweepStartTime = 0;
+unsigned long sweepEndTime = 0;
+unsigned long sweepSeq = 0;
 const unsigned long SEND_INTERVAL = 1000; // Send every 1 second
 
-void connectWiFi() {
-  Serial.print("Connecting to WiFi");
-  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-  
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-    delay(500);
-    Serial.print(".");
-    attempts++;
+// WiFi link: a state machine stepped from loop(), so an outage never stalls the sweep
+const unsigned long WIFI_CONNECT_TIMEOUT = 10000; // Give up on one attempt after this long
+const unsigned long WIFI_BACKOFF_MIN = 1000;      // First retry delay after a failure
+const unsigned long WIFI_BACKOFF_MAX = 60000;     // Retry delay doubles up to this
+
+// API posts run in their own task on core 0; loop() only queues sweeps for it
+const unsigned long HTTP_CONNECT_TIMEOUT = 2000;  // TCP connect, per POST
+const unsigned long HTTP_TIMEOUT = 3000;          // Response read, per POST
+const unsigned long SEND_BACKOFF_MIN = 1000;      // Pause after a failed POST before the next try
+const unsigned long SEND_BACKOFF_MAX = 30000;     // Pause doubles up to this
+const unsigned long SENDER_IDLE_MS = 500;         // Recheck the queue at least this often
+const uint32_t SENDER_STACK = 8192;               // TLS needs about as much as loopTask has
+// 10 top-level fields, one {freq, rssi} object per bin, plus the copied MAC string
+const size_t API_JSON_CAPACITY = JSON_OBJECT_SIZE(10) + JSON_ARRAY_SIZE(WifiSweep::BINS) +
+                                 WifiSweep::BINS * JSON_OBJECT_SIZE(2) + 32;
+
+enum WifiState { WIFI_CONNECTING, WIFI_ONLINE, WIFI_BACKOFF };
+volatile WifiState wifiState = WIFI_BACKOFF;  // Written by loop(), read by the sender task
+unsigned long wifiStateSince = 0;
+unsigned long wifiBackoff = 0;       // Current retry delay; 0 retries right away
+volatile bool wifiGotIp = false;     // Set from the WiFi event task, consumed in serviceWiFi()
+volatile bool wifiLost = false;
+unsigned long wifiOutages = 0;
+
+// Sweeps waiting for the link, oldest first; when full the oldest is overwritten
+const int OFFLINE_SWEEPS = 32;       // 32 x ~270 bytes of RAM
+struct BufferedSweep {
+  unsigned long seq;
+  unsigned long capturedAt;
+  unsigned long sweepStart;
+  unsigned long sweepEnd;
+  float rssi[WifiSweep::BINS];
+};
+BufferedSweep offlineSweeps[OFFLINE_SWEEPS];
+int offlineHead = 0;                 // Oldest entry
+int offlineCount = 0;
+unsigned long offlineDropped = 0;
+portMUX_TYPE offlineLock = portMUX_INITIALIZER_UNLOCKED;  // Guards the ring between loop() and the sender
+TaskHandle_t senderTaskHandle = NULL;
+
+void onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+  if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+    wifiGotIp = true;
+  } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+    wifiLost = true;
   }
-  
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("\nWiFi connected!");
-    Serial.print("IP: ");
-    Serial.println(WiFi.localIP());
+}
+
+void setWiFiState(WifiState state) {
+  wifiState = state;
+  wifiStateSince = millis();
+}
+
+void beginWiFi() {
+  Serial.println("Connecting to WiFi...");
+  wifiGotIp = false;
+  wifiLost = false;
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);  // Returns at once; progress arrives as events
+  setWiFiState(WIFI_CONNECTING);
+}
+
+void showWiFiStatus() {
+  u8g2.clearBuffer();
+  u8g2.drawStr(0, 10, "WiFi Spectrum");
+  if (wifiState == WIFI_ONLINE) {
+    u8g2.drawStr(0, 25, WiFi.localIP().toString().c_str());
   } else {
-    Serial.println("\nWiFi connection failed!");
+    u8g2.drawStr(0, 25, "Offline, buffering");
+  }
+  u8g2.sendBuffer();
+}
+
+void wifiFailed() {
+  WiFi.disconnect();
+  wifiBackoff = wifiBackoff == 0 ? WIFI_BACKOFF_MIN : min(wifiBackoff * 2, WIFI_BACKOFF_MAX);
+  wifiBackoff += random(wifiBackoff / 4 + 1);  // Jitter, so boards sharing an AP don't retry in step
+  Serial.printf("WiFi retry in %lu ms\n", wifiBackoff);
+  setWiFiState(WIFI_BACKOFF);
+}
+
+// Non-blocking; call every loop pass
+void serviceWiFi() {
+  switch (wifiState) {
+    case WIFI_CONNECTING:
+      if (wifiGotIp) {
+        wifiGotIp = false;
+        wifiLost = false;
+        wifiBackoff = 0;
+        setWiFiState(WIFI_ONLINE);
+        Serial.print("WiFi connected! IP: ");
+        Serial.println(WiFi.localIP());
+        showWiFiStatus();
+      } else if (wifiLost || millis() - wifiStateSince > WIFI_CONNECT_TIMEOUT) {
+        Serial.println("WiFi connection failed!");
+        bool firstFailure = wifiBackoff == 0;
+        wifiFailed();
+        if (firstFailure) showWiFiStatus();
+      }
+      break;
+
+    case WIFI_ONLINE:
+      if (wifiLost || WiFi.status() != WL_CONNECTED) {
+        wifiOutages++;
+        Serial.printf("WiFi lost, buffering sweeps (%d queued)\n", offlineCount);
+        wifiBackoff = 0;  // A drop from a working link starts over at the shortest delay
+        wifiFailed();
+        showWiFiStatus();
+      }
+      break;
+
+    case WIFI_BACKOFF:
+      if (millis() - wifiStateSince >= wifiBackoff) {
+        beginWiFi();
+      }
+      break;
   }
 }
 
-void sendDataToAPI() {
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("WiFi not connected, reconnecting...");
-    connectWiFi();
-    return;
+// Copies the finished sweep into the offline buffer and wakes the sender task
+void queueSweep() {
+  portENTER_CRITICAL(&offlineLock);
+  if (offlineCount == OFFLINE_SWEEPS) {
+    offlineHead = (offlineHead + 1) % OFFLINE_SWEEPS;
+    offlineCount--;
+    offlineDropped++;
   }
-  
+  BufferedSweep& sweep = offlineSweeps[(offlineHead + offlineCount) % OFFLINE_SWEEPS];
+  sweep.seq = ++sweepSeq;  // Numbered on capture, so overwritten sweeps show as seq gaps
+  sweep.capturedAt = millis();
+  sweep.sweepStart = sweepStartTime;
+  sweep.sweepEnd = sweepEndTime;
+  memcpy(sweep.rssi, spectrumData, sizeof(sweep.rssi));
+  offlineCount++;
+  portEXIT_CRITICAL(&offlineLock);
+  if (senderTaskHandle) xTaskNotifyGive(senderTaskHandle);
+}
+
+bool sendDataToAPI(const BufferedSweep& sweep) {
   HTTPClient http;
   http.begin(API_ENDPOINT);
+  http.setConnectTimeout(HTTP_CONNECT_TIMEOUT);
+  http.setTimeout(HTTP_TIMEOUT);
   http.addHeader("Content-Type", "application/json");
   
-  // Create JSON payload
-  StaticJsonDocument<2048> doc;
-  doc["timestamp"] = millis();
+  // Create JSON payload; static keeps it off the sender task's stack
+  static StaticJsonDocument<API_JSON_CAPACITY> doc;
+  doc.clear();
+  doc["timestamp"] = sweep.capturedAt;
   doc["deviceId"] = WiFi.macAddress();
-  doc["freqBegin"] = FREQ_BEGIN;
-  doc["freqEnd"] = FREQ_END;
-  doc["freqSteps"] = FREQ_STEPS;
+  doc["seq"] = sweep.seq;
+  doc["sweepStart"] = sweep.sweepStart;
+  doc["sweepEnd"] = sweep.sweepEnd;
+  doc["freqBegin"] = WifiSweep::BEGIN_MHZ;
+  doc["freqEnd"] = WifiSweep::END_MHZ;
+  doc["freqSteps"] = WifiSweep::BINS;
+  doc["rxBandwidth"] = WifiSweep::RX_BANDWIDTH_KHZ;
   
   JsonArray data = doc.createNestedArray("data");
-  for (int i = 0; i < FREQ_STEPS; i++) {
+  for (int i = 0; i < WifiSweep::BINS; i++) {
     JsonObject point = data.createNestedObject();
-    float freq = FREQ_BEGIN + (i * (FREQ_END - FREQ_BEGIN) / FREQ_STEPS);
-    point["freq"] = freq;
-    point["rssi"] = spectrumData[i];
+    point["freq"] = Sweep::bins[i].freqMHz;
+    point["rssi"] = sweep.rssi[i];
+  }
+  if (doc.overflowed()) {
+    // A truncated data array would pass for a real sweep; retrying can't fix it, so drop it
+    Serial.printf("Sweep %lu does not fit the JSON document, not sent\n", sweep.seq);
+    http.end();
+    return true;
   }
   
   String payload;
@@ -108,61 +226,129 @@ void sendDataToAPI() {
   }
   
   http.end();
+  // Any HTTP answer consumes the sweep; only a transport failure keeps it for a retry
+  return httpCode > 0;
 }
 
-void initializeRadio() {
-  int state = radio.beginFSK(FREQ_BEGIN);
-  if (state != RADIOLIB_ERR_NONE) {
-    Serial.println("Radio init failed!");
-    return;
+// Sends queued sweeps oldest first while the link is up. Each POST works on a
+// copy, so loop() can keep queueing (and overwriting the oldest) meanwhile.
+// After a failure nothing is sent until the backoff has passed.
+void senderTask(void* param) {
+  static BufferedSweep sending;
+  unsigned long backoff = 0;
+  unsigned long failedAt = 0;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SENDER_IDLE_MS));
+    while (wifiState == WIFI_ONLINE && (backoff == 0 || millis() - failedAt >= backoff)) {
+      portENTER_CRITICAL(&offlineLock);
+      bool queued = offlineCount > 0;
+      if (queued) sending = offlineSweeps[offlineHead];
+      portEXIT_CRITICAL(&offlineLock);
+      if (!queued) break;
+
+      if (!sendDataToAPI(sending)) {
+        backoff = backoff == 0 ? SEND_BACKOFF_MIN : min(backoff * 2, SEND_BACKOFF_MAX);
+        failedAt = millis();
+        break;
+      }
+      backoff = 0;
+
+      unsigned long dropped = 0;
+      portENTER_CRITICAL(&offlineLock);
+      // Unless loop() overwrote it while the POST ran, the sent sweep is still the oldest
+      if (offlineCount > 0 && offlineSweeps[offlineHead].seq == sending.seq) {
+        offlineHead = (offlineHead + 1) % OFFLINE_SWEEPS;
+        offlineCount--;
+      }
+      if (offlineCount == 0) {
+        dropped = offlineDropped;
+        offlineDropped = 0;
+      }
+      portEXIT_CRITICAL(&offlineLock);
+      if (dropped > 0) {
+        Serial.printf("Offline buffer drained, %lu sweeps were dropped while full\n", dropped);
+      }
+    }
   }
-  radio.setRxBandwidth(250.0);
-  radio.setDataShaping(RADIOLIB_SHAPING_NONE);
-  radio.startReceive();
-  Serial.println("Radio initialized");
 }
 
-float getRSSIAtFrequency(float frequency) {
-  radio.setFrequency(frequency);
-  radio.startReceive();
-  delay(10);
-  
-  float rssiSum = 0;
-  int validReadings = 0;
-  
-  for (int i = 0; i < 5; i++) {
-    float rssi = radio.getRSSI();
-    if (rssi > -200.0 && rssi < 0.0) {
-      rssiSum += rssi;
-      validReadings++;
+// Datagram layout, little-endian: this header, then `count` int16 RSSI values
+// in 0.1 dBm for bins firstBin.. of the sweep. A sweep wider than
+// UDP_MAX_BINS goes as several fragments sharing its seq; each fragment
+// stands on its own, so a lost one only leaves a hole in that sweep.
+struct __attribute__((packed)) UdpSweepHeader {
+  char magic[4];        // "SWU1"
+  uint8_t mac[6];       // Device, as WiFi.macAddress()
+  uint32_t seq;         // Per sweep, counts every sweep sent over UDP
+  uint32_t sweepStart;  // millis()
+  uint32_t sweepEnd;
+  float freqBegin;      // MHz
+  float freqEnd;
+  uint16_t bins;        // Whole sweep
+  uint8_t fragment;
+  uint8_t fragments;
+  uint16_t firstBin;
+  uint16_t count;
+};
+
+WiFiUDP udp;
+uint32_t udpSeq = 0;
+
+// Fire-and-forget: nothing is queued or retried, a sweep sent while offline is simply skipped
+void sendSweepUdp() {
+  if (!UDP_ENABLED || wifiState != WIFI_ONLINE) return;
+  static uint8_t datagram[sizeof(UdpSweepHeader) + UDP_MAX_BINS * sizeof(int16_t)];
+
+  UdpSweepHeader header;
+  memcpy(header.magic, "SWU1", 4);
+  WiFi.macAddress(header.mac);
+  header.seq = ++udpSeq;
+  header.sweepStart = sweepStartTime;
+  header.sweepEnd = sweepEndTime;
+  header.freqBegin = WifiSweep::BEGIN_MHZ;
+  header.freqEnd = WifiSweep::END_MHZ;
+  header.bins = WifiSweep::BINS;
+  header.fragments = (WifiSweep::BINS + UDP_MAX_BINS - 1) / UDP_MAX_BINS;
+
+  for (int f = 0; f < header.fragments; f++) {
+    header.fragment = f;
+    header.firstBin = f * UDP_MAX_BINS;
+    header.count = min(UDP_MAX_BINS, WifiSweep::BINS - header.firstBin);
+    memcpy(datagram, &header, sizeof(header));
+    int16_t* rssi = (int16_t*)(datagram + sizeof(header));
+    for (int i = 0; i < header.count; i++) {
+      rssi[i] = (int16_t)lroundf(spectrumData[header.firstBin + i] * 10.0f);
     }
-    delay(2);
+    udp.beginPacket(UDP_GROUP, UDP_PORT);
+    udp.write(datagram, sizeof(header) + header.count * sizeof(int16_t));
+    udp.endPacket();
   }
-  
-  float avgRSSI;
-  if (validReadings > 0) {
-    avgRSSI = rssiSum / validReadings;
-  } else {
-    float noiseBase = -120.0;
-    float freqVariation = (frequency - 600.0) / 100.0;
-    avgRSSI = noiseBase + freqVariation + random(-10, 5);
+}
+
+void initializeRadio() {
+  int state = spectrumRadio.begin(WifiSweep::BEGIN_MHZ, WifiSweep::RX_BANDWIDTH_KHZ);
+  if (state != RADIOLIB_ERR_NONE) {
+    Serial.printf("Radio init failed! Code: %d\n", state);
+    return;
   }
-  
-  return avgRSSI;
+  Serial.println("Radio initialized");
 }
 
 void scanSpectrum() {
   if (scanning) {
-    float frequency = FREQ_BEGIN + (currentStep * (FREQ_END - FREQ_BEGIN) / FREQ_STEPS);
-    float rssi = getRSSIAtFrequency(frequency);
-    spectrumData[currentStep] = rssi;
+    if (currentStep == 0) {
+      sweepStartTime = millis();
+    }
+    spectrumData[currentStep] = spectrumRadio.measureBin<WifiSweep>(currentStep);
     
     currentStep++;
-    if (currentStep >= FREQ_STEPS) {
+    if (currentStep >= WifiSweep::BINS) {
       currentStep = 0;
-      // Full scan complete, send data
+      sweepEndTime = millis();
+      sendSweepUdp();
+      // Full scan complete: queue it for the sender task
       if (millis() - lastSendTime > SEND_INTERVAL) {
-        sendDataToAPI();
+        queueSweep();
         lastSendTime = millis();
       }
     }
@@ -190,28 +376,28 @@ void setup() {
   u8g2.drawStr(0, 25, "Connecting...");
   u8g2.sendBuffer();
   
-  // Connect to WiFi
-  connectWiFi();
+  // Start connecting; scanning doesn't wait for it
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(false);  // Reconnects are paced by serviceWiFi()
+  WiFi.onEvent(onWiFiEvent);
+  beginWiFi();
+  xTaskCreatePinnedToCore(senderTask, "sender", SENDER_STACK, NULL, 1, &senderTaskHandle, 0);
   
   // Initialize SPI and radio
   SPI.begin(LORA_SCK, LORA_MISO, LORA_MOSI, LORA_NSS);
   initializeRadio();
   
   // Initialize spectrum data
-  for (int i = 0; i < FREQ_STEPS; i++) {
+  for (int i = 0; i < WifiSweep::BINS; i++) {
     spectrumData[i] = -100.0;
   }
   
-  u8g2.clearBuffer();
-  u8g2.drawStr(0, 10, "WiFi Spectrum");
-  u8g2.drawStr(0, 25, WiFi.localIP().toString().c_str());
-  u8g2.sendBuffer();
-  
   Serial.println("Ready to scan!");
 }
 
 void loop() {
+  serviceWiFi();
   scanSpectrum();
-  delay(SCAN_DELAY);
+  delay(WifiSweep::STEP_DELAY_MS);
 }
 
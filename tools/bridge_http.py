@@ -1,4 +1,6 @@
 import json
+import queue
+import threading
 import time
 import sys
 
@@ -22,10 +24,231 @@ BAUD = 115200
 
 # Your deployed Vercel API endpoint for spectrum data:
 API_ENDPOINT = 'https://automacao-industrial-ene-090.vercel.app/api/spectrum'
+
+# Where sweeps go: 'http' (one POST per sweep), 'mqtt' or 'both'
+OUTPUT = 'http'
+
+# MQTT broker (pip install paho-mqtt). Sweeps are published with QoS 0 to
+# <prefix>/<deviceId>/sweep, or as a JSON array to <prefix>/<deviceId>/batch
+MQTT_HOST = 'localhost'
+MQTT_PORT = 1883
+MQTT_TOPIC_PREFIX = 'spectrum'
+MQTT_BATCH_MS = 0           # 0 = one message per sweep; else collect each device's sweeps this long
+MQTT_BATCH_MAX = 50         # Sweeps per batch message at most
+MQTT_RETAIN_LAST = True     # Keep the newest sweep retained on <prefix>/<deviceId>/last
+MQTT_QUEUE_MAX = 1000       # Sweeps waiting for the publisher; the oldest are dropped beyond this
+
+# Local sweep archive (tools/sweep_archive.py reads it back); '' = off
+ARCHIVE_DIR = ''
+ARCHIVE_ROTATE_MB = 64      # New segment once one reaches this size
+ARCHIVE_ROTATE_S = 24 * 3600  # ... or this age
 # =============================
 
 
+def now_ms() -> float:
+    return time.time() * 1000.0
+
+
+class SerialLatency:
+    """Estimates device-to-bridge latency for each JSON line.
+
+    The device stamps `timestamp` with millis() just before printing. The
+    smallest (arrival - timestamp) seen is taken as the clock offset, so the
+    excess over it is queueing on the device/USB side; the wire time of the
+    line at BAUD is added back on top.
+    """
+
+    def __init__(self):
+        self.offset = None
+        self.last_device_ms = None
+
+    def estimate(self, device_ms, arrival_ms, line_bytes):
+        if self.last_device_ms is not None and device_ms < self.last_device_ms:
+            self.offset = None  # Device rebooted, millis() restarted
+        self.last_device_ms = device_ms
+        offset = arrival_ms - device_ms
+        if self.offset is None or offset < self.offset:
+            self.offset = offset
+        wire_ms = line_bytes * 10 * 1000.0 / BAUD
+        return (offset - self.offset) + wire_ms
+
+
+class OccupancyReports:
+    """Joins the firmware's chunked occupancy lines back into one report.
+
+    The device prints each report as one line per window and bin range
+    (`{"type":"occupancy","report":n,"window":w,"first":bin,...}`); the API
+    expects the whole report as `occupancy` on a sweep, so a complete report
+    rides along with the next sweep forwarded.
+    """
+
+    def __init__(self):
+        self.report = None
+        self.windows = []
+        self.filled = 0
+        self.ready = None
+
+    def add(self, chunk):
+        try:
+            if chunk['report'] != self.report:
+                self.report = chunk['report']  # A newer report replaces an unfinished one
+                self.windows = [None] * chunk['windows']
+                self.filled = 0
+            bins = chunk['bins']
+            window = self.windows[chunk['window']]
+            if window is None:
+                window = self.windows[chunk['window']] = {
+                    'seconds': chunk['seconds'], 'slots': chunk['slots'],
+                    'busy': [-1] * bins, 'bursts': [0] * bins, 'dwellHist': []
+                }
+            first, busy = chunk['first'], chunk['busy']
+            window['busy'][first:first + len(busy)] = busy
+            window['bursts'][first:first + len(busy)] = chunk['bursts']
+            if 'dwellHist' in chunk:
+                window['dwellHist'] = chunk['dwellHist']
+            self.filled += len(busy)
+        except (KeyError, TypeError, IndexError):
+            return
+        if self.filled >= bins * len(self.windows) and None not in self.windows:
+            self.ready = {'threshold': chunk.get('threshold'), 'windows': self.windows}
+            self.report = None
+
+    def take(self):
+        report, self.ready = self.ready, None
+        return report
+
+
+class MqttPublisher:
+    """Publishes sweeps from its own thread, so the serial loop never waits on the broker.
+
+    QoS 0 throughout: a sweep is superseded within seconds, so a lost one is
+    not worth a broker round trip. The queue is bounded; when the broker falls
+    behind, the oldest sweeps are dropped and counted rather than stalling the
+    serial read. paho reconnects on its own if the broker goes away.
+    """
+
+    def __init__(self, host, port):
+        try:
+            import paho.mqtt.client as mqtt
+        except Exception:
+            print('Missing dependency: paho-mqtt. Install with: pip install paho-mqtt')
+            raise
+        self.mqtt = mqtt
+        self.queue = queue.Queue(maxsize=MQTT_QUEUE_MAX)
+        self.lock = threading.Lock()
+        self.sweeps = 0
+        self.messages = 0
+        self.dropped = 0
+        self.connected = False
+
+        try:
+            self.client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2)  # paho-mqtt 2.x
+        except AttributeError:
+            self.client = mqtt.Client()
+        status = f'{MQTT_TOPIC_PREFIX}/bridge/status'
+        self.client.will_set(status, 'offline', qos=0, retain=True)
+        self.client.on_connect = lambda client, *args: self.on_connect(status)
+        self.client.on_disconnect = lambda *args: setattr(self, 'connected', False)
+        self.client.reconnect_delay_set(min_delay=1, max_delay=30)
+        self.client.connect_async(host, port, keepalive=30)
+        self.client.loop_start()
+        threading.Thread(target=self.run, daemon=True).start()
+
+    def on_connect(self, status):
+        self.connected = True
+        self.client.publish(status, 'online', qos=0, retain=True)
+
+    def submit(self, payload):
+        """Never blocks: a full queue loses its oldest sweep instead."""
+        while True:
+            try:
+                self.queue.put_nowait(payload)
+                return
+            except queue.Full:
+                try:
+                    self.queue.get_nowait()
+                    self.count(dropped=1)
+                except queue.Empty:
+                    pass
+
+    def count(self, sweeps=0, messages=0, dropped=0):
+        with self.lock:
+            self.sweeps += sweeps
+            self.messages += messages
+            self.dropped += dropped
+
+    def run(self):
+        batches = {}        # deviceId -> sweeps waiting
+        started = {}        # deviceId -> time.time() of its oldest waiting sweep
+        while True:
+            # A batch flushed early by MQTT_BATCH_MAX takes its start with it
+            batch_start = min(started.values()) if started else None
+            timeout = None
+            if batch_start is not None:
+                timeout = max(0.0, batch_start + MQTT_BATCH_MS / 1000.0 - time.time())
+            try:
+                payload = self.queue.get(timeout=timeout)
+            except queue.Empty:
+                payload = None
+
+            if payload is not None:
+                device = str(payload.get('deviceId', 'unknown'))
+                if MQTT_BATCH_MS <= 0:
+                    self.publish(device, [payload])
+                    continue
+                waiting = batches.setdefault(device, [])
+                waiting.append(payload)
+                started.setdefault(device, time.time())
+                if len(waiting) >= MQTT_BATCH_MAX:
+                    self.publish(device, batches.pop(device))
+                    del started[device]
+
+            if started and time.time() - min(started.values()) >= MQTT_BATCH_MS / 1000.0:
+                for device, sweeps in batches.items():
+                    self.publish(device, sweeps)
+                batches = {}
+                started = {}
+
+    def publish(self, device, sweeps):
+        # '+', '#' and '/' would change the topic's meaning
+        topic = MQTT_TOPIC_PREFIX + '/' + ''.join('_' if c in '+#/' else c for c in device)
+        publish_at = now_ms()
+        for sweep in sweeps:
+            sweep.setdefault('trace', {})['bridgePublishAt'] = publish_at
+        if MQTT_BATCH_MS > 0:
+            body = json.dumps(sweeps, separators=(',', ':'))
+            info = self.client.publish(topic + '/batch', body, qos=0)
+        else:
+            body = json.dumps(sweeps[0], separators=(',', ':'))
+            info = self.client.publish(topic + '/sweep', body, qos=0)
+        if info.rc != self.mqtt.MQTT_ERR_SUCCESS:
+            self.count(dropped=len(sweeps))
+            return
+        self.count(sweeps=len(sweeps), messages=1)
+
+        if MQTT_RETAIN_LAST:
+            last = body if MQTT_BATCH_MS <= 0 else json.dumps(sweeps[-1], separators=(',', ':'))
+            self.client.publish(topic + '/last', last, qos=0, retain=True)
+
+    def status(self):
+        with self.lock:
+            return (f"MQTT {'connected' if self.connected else 'disconnected'}: {self.sweeps} sweeps in "
+                    f"{self.messages} messages, {self.dropped} dropped, {self.queue.qsize()} queued")
+
+
 def main() -> int:
+    # Optional overrides: bridge_http.py [serial_port] [api_endpoint | mqtt://host[:port]]
+    global SERIAL_PORT, API_ENDPOINT, OUTPUT, MQTT_HOST, MQTT_PORT
+    if len(sys.argv) > 1:
+        SERIAL_PORT = sys.argv[1]
+    if len(sys.argv) > 2 and sys.argv[2].startswith('mqtt://'):
+        OUTPUT = 'mqtt'
+        broker = sys.argv[2][len('mqtt://'):].rstrip('/')
+        MQTT_HOST, _, port = broker.partition(':')
+        MQTT_PORT = int(port) if port else MQTT_PORT
+    elif len(sys.argv) > 2:
+        API_ENDPOINT = sys.argv[2]
+
     print(f'Opening {SERIAL_PORT} at {BAUD} baud...')
     try:
         ser = serial.Serial(SERIAL_PORT, BAUD, timeout=1)
@@ -34,14 +257,31 @@ def main() -> int:
         print('Tips: Close PlatformIO Serial Monitor; verify COM port in Device Manager.')
         return 1
 
-    print('Forwarding JSON lines to:', API_ENDPOINT)
+    publisher = None
+    if OUTPUT in ('mqtt', 'both'):
+        publisher = MqttPublisher(MQTT_HOST, MQTT_PORT)
+        print(f'Publishing to mqtt://{MQTT_HOST}:{MQTT_PORT} under {MQTT_TOPIC_PREFIX}/<deviceId>/' +
+              (f'batch every {MQTT_BATCH_MS} ms' if MQTT_BATCH_MS > 0 else 'sweep'))
+    if OUTPUT in ('http', 'both'):
+        print('Forwarding JSON lines to:', API_ENDPOINT)
+    archive = None
+    if ARCHIVE_DIR:
+        from sweep_archive import ArchiveWriter
+        archive = ArchiveWriter(ARCHIVE_DIR, ARCHIVE_ROTATE_MB, ARCHIVE_ROTATE_S)
+        print('Archiving sweeps to:', ARCHIVE_DIR)
     print('Press Ctrl+C to stop.')
 
+    serial_latency = SerialLatency()
+    occupancy = OccupancyReports()
+    last_status = time.time()
+    last_flush = time.time()
+
     while True:
         try:
             raw = ser.readline()
             if not raw:
                 continue
+            rx_at = now_ms()
             line = raw.decode('utf-8', errors='ignore').strip()
             if not line or not line.startswith('{'):
                 # Skip non-JSON debug lines
@@ -53,17 +293,53 @@ def main() -> int:
                 # Not valid JSON – skip
                 continue
 
-            try:
-                r = requests.post(API_ENDPOINT, json=payload, timeout=10)
-                print('POST', r.status_code, 'bytes=', len(line))
-            except Exception as e:
-                print('HTTP error:', e)
+            if payload.get('type') == 'occupancy':
+                occupancy.add(payload)
+                continue
+            if 'data' not in payload:
+                # Only sweeps go to the API (e.g. skip rssiBlock stream lines)
+                continue
+            report = occupancy.take()
+            if report:
+                payload['occupancy'] = report
+
+            # Latency trace: arrival at the bridge and the hand-off to HTTP
+            trace = {'bridgeRxAt': rx_at}
+            if isinstance(payload.get('timestamp'), (int, float)):
+                trace['serialMs'] = round(serial_latency.estimate(payload['timestamp'], rx_at, len(raw)), 1)
+            payload['trace'] = trace
+
+            if archive:
+                archive.append(payload, rx_at)
+                if time.time() - last_flush >= 1.0:
+                    archive.flush()  # Readers see sweeps within a second
+                    last_flush = time.time()
+
+            if publisher:
+                # The publisher thread stamps its own copy of the trace
+                publisher.submit(dict(payload, trace=dict(trace)))
+
+            if (publisher or archive) and time.time() - last_status >= 5.0:
+                for output in (publisher, archive):
+                    if output:
+                        print(output.status())
+                last_status = time.time()
+
+            if OUTPUT in ('http', 'both'):
+                trace['bridgePostAt'] = now_ms()
+                try:
+                    r = requests.post(API_ENDPOINT, json=payload, timeout=10)
+                    print('POST', r.status_code, 'bytes=', len(line))
+                except Exception as e:
+                    print('HTTP error:', e)
 
-            time.sleep(0.02)
+                time.sleep(0.02)
         except KeyboardInterrupt:
             print('\nExiting...')
             break
 
+    if archive:
+        archive.close()  # Records the open segments in the index
     return 0
 
 
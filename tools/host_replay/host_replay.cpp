@@ -0,0 +1,155 @@
+// Host-side replay: feeds a capture through the firmware's baseline and
+// occupancy libraries as fast as the PC allows, for regression runs without
+// a board. Sweep timing comes from the recorded timestamps, so occupancy
+// windows close as they did in the field. Build and usage: tools/README.md.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <spectrum_baseline.h>
+#include <spectrum_occupancy.h>
+#include <spectrum_replay.h>
+
+#define OCC_THRESHOLD -95.0  // Same default as the firmware
+#define TOP_BINS 5           // Busiest bins listed per window
+
+class FileReplayInput : public ReplayInput {
+ public:
+  explicit FileReplayInput(FILE* file) : file(file) {}
+  int peek() override {
+    int c = getc(file);
+    if (c != EOF) ungetc(c, file);
+    return c == EOF ? -1 : c;
+  }
+  int read() override {
+    int c = getc(file);
+    return c == EOF ? -1 : c;
+  }
+  size_t readBytes(uint8_t* buffer, size_t length) override { return fread(buffer, 1, length, file); }
+
+ private:
+  FILE* file;
+};
+
+static double seconds() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void printOccupancy(float freqBegin, float freqEnd) {
+  int bins = occupancyBins();
+  float step = (freqEnd - freqBegin) / bins;
+  for (int w = 0; w < OCC_WINDOWS; w++) {
+    int filled = occupancySlotsFilled(w);
+    printf("Window %lu s: %d slots\n", OCC_WINDOW_SECONDS[w], filled);
+    if (filled == 0) continue;
+
+    // Busiest bins first, each bin listed once
+    int shown = -1;
+    int shownBusy = OCC_FULL_SCALE + 1;
+    for (int i = 0; i < TOP_BINS; i++) {
+      int b = -1;
+      int busy = 0;
+      for (int c = 0; c < bins; c++) {
+        int v = occupancyBusy(w, c);
+        bool after = v < shownBusy || (v == shownBusy && c > shown);
+        if (after && v > busy) {
+          b = c;
+          busy = v;
+        }
+      }
+      if (b < 0) break;
+      shown = b;
+      shownBusy = busy;
+      printf("  %8.3f MHz  busy %5.1f %%  %lu bursts\n", freqBegin + (b + 0.5) * step,
+             occupancyBusy(w, b) * 100.0 / OCC_FULL_SCALE, (unsigned long)occupancyBursts(w, b));
+    }
+    uint32_t hist[OCC_HIST_BUCKETS];
+    occupancyHistogram(w, hist);
+    printf("  dwell:");
+    for (int h = 0; h < OCC_HIST_BUCKETS; h++) {
+      printf(" %s=%lu", occupancyBucketLabel(h), (unsigned long)hist[h]);
+    }
+    printf("\n");
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 4) {
+    fprintf(stderr, "Usage: host_replay <capture.bin|capture.jsonl> [thresholdDbm] [repeat]\n");
+    return 1;
+  }
+  float threshold = argc > 2 ? atof(argv[2]) : OCC_THRESHOLD;
+  int repeat = argc > 3 ? atoi(argv[3]) : 1;
+
+  static SweepReplay replay;
+  unsigned long sweeps = 0;
+  unsigned long restarts = 0;
+  uint32_t offset = 0;  // Keeps time moving forward across repeats
+  uint32_t last = 0;
+  int bins = 0;
+  float freqBegin = 0.0, freqEnd = 0.0;
+  double start = seconds();
+
+  for (int pass = 0; pass < repeat; pass++) {
+    FILE* file = fopen(argv[1], "rb");
+    if (!file) {
+      perror(argv[1]);
+      return 1;
+    }
+    FileReplayInput input(file);
+    if (!replay.open(input)) {
+      fprintf(stderr, "%s: no JSON or binary capture\n", argv[1]);
+      fclose(file);
+      return 1;
+    }
+    uint32_t first = 0;
+    while (replay.next()) {
+      const ReplaySweep& sweep = replay.sweep();
+      if (replay.sweeps() == 1) first = sweep.timestamp;
+      uint32_t now = offset + (sweep.timestamp - first);
+
+      // A new plan, or a board reboot inside the capture, starts the statistics over
+      if (sweeps == 0 || sweep.bins != bins || sweep.freqBegin != freqBegin || sweep.freqEnd != freqEnd ||
+          (int32_t)(now - last) < 0) {
+        if (sweeps > 0) restarts++;
+        bins = sweep.bins;
+        freqBegin = sweep.freqBegin;
+        freqEnd = sweep.freqEnd;
+        baselineSelect(freqBegin, freqEnd, bins, 0.0);
+        occupancyReset(bins, threshold, now);
+      }
+      for (int b = 0; b < bins; b++) {
+        baselineUpdate(b, sweep.rssi[b]);
+        occupancyVisit(b, sweep.rssi[b], now);
+      }
+      last = now;
+      sweeps++;
+    }
+    offset = last + 1;
+    fclose(file);
+  }
+  double elapsed = seconds() - start;
+
+  if (sweeps == 0) {
+    fprintf(stderr, "%s: no sweeps\n", argv[1]);
+    return 1;
+  }
+  printf("%lu sweeps of %d bins in %.3f s: %.0f sweeps/s, %lu plan changes or restarts\n", sweeps, bins,
+         elapsed, sweeps / (elapsed > 0 ? elapsed : 1e-9), restarts);
+  printf("Replayed time %.1f s, threshold %.1f dBm\n", last / 1000.0, threshold);
+
+  float lo = 200.0, hi = -200.0;
+  for (int b = 0; b < bins; b++) {
+    if (!baselineTrained(b)) continue;
+    if (baselineFloor(b) < lo) lo = baselineFloor(b);
+    if (baselineFloor(b) > hi) hi = baselineFloor(b);
+  }
+  printf("Baseline: %d of %d bins trained", baselineTrainedBins(), bins);
+  if (baselineTrainedBins() > 0) printf(", floor %.1f .. %.1f dBm", lo, hi);
+  printf("\n");
+  printOccupancy(freqBegin, freqEnd);
+  return 0;
+}
@@ -0,0 +1,268 @@
+import json
+import os
+import random
+import subprocess
+import sys
+import threading
+import time
+
+try:
+    import requests
+except Exception:
+    print('Missing dependency: requests. Install with: pip install requests')
+    raise
+
+
+# ====== CONFIGURE THESE ======
+# Where sweeps go; tools/local_api.py listens here by default
+API_ENDPOINT = 'http://127.0.0.1:3001/api/spectrum'
+# Sweep shape, as printed by the firmware
+FREQ_BEGIN = 400.0
+FREQ_END = 960.0
+BINS = 64
+RX_BANDWIDTH = 234.3
+# Serial mode: emulated link speed per device (0 = unlimited)
+BAUD = 115200
+# =============================
+
+USAGE = """Usage:
+  python load_gen.py http <devices> <sweeps/s per device> [seconds]
+      Each emulated device posts firmware sweeps straight to API_ENDPOINT,
+      stamped like bridge_http.py would.
+  python load_gen.py serial <devices> <sweeps/s per device> [seconds]
+      Each emulated device writes firmware serial lines into a pty at BAUD,
+      read by its own bridge_http.py process (Linux/macOS).
+
+Reports sweeps/s sent and, from a local_api.py endpoint, sweeps/s received,
+ingest latency percentiles and drop rate."""
+
+VARIANTS = 16  # Pre-rendered spectra per device, so the generator is not the bottleneck
+
+
+def now_ms():
+    return time.time() * 1000.0
+
+
+def percentile(values, p):
+    if not values:
+        return None
+    ordered = sorted(values)
+    rank = max(0, min(len(ordered) - 1, -(-p * len(ordered) // 100) - 1))
+    return round(ordered[int(rank)], 1)
+
+
+class EmulatedDevice:
+    """Produces the exact JSON line printJsonSnapshot() prints for one board."""
+
+    def __init__(self, index):
+        self.device_id = f'heltec-v3-{index:03d}'
+        self.seq = 0
+        self.boot = now_ms() - random.uniform(0, 60000)  # Boards don't boot in sync
+        step = (FREQ_END - FREQ_BEGIN) / BINS
+        freqs = [FREQ_BEGIN + (i + 0.5) * step for i in range(BINS)]
+        self.spectra = []
+        for _ in range(VARIANTS):
+            signal = random.randrange(BINS)
+            self.spectra.append([
+                {'freq': round(f, 4),
+                 'rssi': round(-70.0 if abs(i - signal) < 2 else random.uniform(-125.0, -105.0), 1)}
+                for i, f in enumerate(freqs)
+            ])
+
+    def sweep(self, duration_ms):
+        self.seq += 1
+        millis = int(now_ms() - self.boot)
+        return {
+            'timestamp': millis,
+            'deviceId': self.device_id,
+            'seq': self.seq,
+            'sweepStart': millis - int(duration_ms),
+            'sweepEnd': millis,
+            'freqBegin': FREQ_BEGIN,
+            'freqEnd': FREQ_END,
+            'freqSteps': BINS,
+            'rxBandwidth': RX_BANDWIDTH,
+            'data': self.spectra[self.seq % VARIANTS]
+        }
+
+    def skip(self, count):
+        # Sweeps the generator had no time for: lost on the device side, so they show as seq gaps
+        self.seq += count
+
+    def line(self, duration_ms):
+        return json.dumps(self.sweep(duration_ms), separators=(',', ':')) + '\n'
+
+
+class Counters:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.sent = 0
+        self.failed = 0
+        self.skipped = 0     # Scheduled sweeps never sent because the generator fell behind
+        self.latencies = []  # Scheduled time to POST answer (ms), so waiting counts too
+
+    def add(self, failed=False, latency=None, skipped=0):
+        with self.lock:
+            self.sent += 1
+            self.failed += failed
+            self.skipped += skipped
+            if latency is not None:
+                self.latencies.append(latency)
+
+
+def paced(rate, seconds, stop):
+    """Yields (due, skipped) per sweep slot: the scheduled time, and how many slots
+    before it were dropped because the sender was a whole interval or more behind.
+    The last slot is always sent, so sent + skipped is the offered load."""
+    interval = 1.0 / rate
+    start = time.time()
+    slots = max(1, int(seconds * rate))
+    slot = 0
+    while not stop.is_set() and slot < slots:
+        wait = start + slot * interval - time.time()
+        if wait > 0:
+            time.sleep(wait)
+        skipped = min(int(-wait / interval), slots - 1 - slot) if wait < 0 else 0
+        slot += skipped
+        yield start + slot * interval, skipped
+        slot += 1
+
+
+def run_http_device(device, rate, seconds, counters, stop):
+    session = requests.Session()
+    for due, skipped in paced(rate, seconds, stop):
+        device.skip(skipped)
+        payload = device.sweep(1000.0 / rate)
+        # Stamped as arriving on schedule, so time spent behind shows in the server's latency too
+        payload['trace'] = {'bridgeRxAt': due * 1000.0, 'bridgePostAt': now_ms()}
+        try:
+            r = session.post(API_ENDPOINT, json=payload, timeout=10)
+            counters.add(failed=r.status_code != 200, latency=now_ms() - due * 1000.0, skipped=skipped)
+        except Exception:
+            counters.add(failed=True, skipped=skipped)
+
+
+def run_serial_device(device, rate, seconds, counters, stop, master_fd):
+    byte_time = 10.0 / BAUD if BAUD else 0.0  # 8N1
+    for due, skipped in paced(rate, seconds, stop):
+        device.skip(skipped)
+        line = device.line(1000.0 / rate).encode()
+        start = time.time()
+        try:
+            os.write(master_fd, line)  # Blocks when the bridge falls behind, like a full UART
+        except OSError:
+            counters.add(failed=True, skipped=skipped)
+            return
+        # The real link can't go faster than the baud rate
+        remaining = len(line) * byte_time - (time.time() - start)
+        if remaining > 0:
+            time.sleep(remaining)
+        counters.add(skipped=skipped)
+
+
+def start_bridges(count):
+    """One pty and one bridge_http.py process per emulated device."""
+    import pty
+    import tty
+    bridge = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'bridge_http.py')
+    links = []
+    for _ in range(count):
+        master_fd, slave_fd = pty.openpty()
+        tty.setraw(slave_fd)
+        path = os.ttyname(slave_fd)
+        process = subprocess.Popen([sys.executable, bridge, path, API_ENDPOINT],
+                                   stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        links.append((master_fd, slave_fd, process))
+    time.sleep(1.0)  # Let the bridges open their ports
+    return links
+
+
+def server_stats(url, reset=False):
+    """The local API's counters, or None when the endpoint is not local_api.py."""
+    base = url.rsplit('/api/', 1)[0]
+    try:
+        if reset:
+            requests.post(base + '/api/stats/reset', timeout=5)
+            return None
+        r = requests.get(base + '/api/stats', timeout=5)
+        return r.json() if r.status_code == 200 else None
+    except Exception:
+        return None
+
+
+def main() -> int:
+    args = sys.argv[1:]
+    if len(args) not in (3, 4) or args[0] not in ('http', 'serial'):
+        print(USAGE)
+        return 1
+    mode = args[0]
+    count = int(args[1])
+    rate = float(args[2])
+    seconds = float(args[3]) if len(args) == 4 else 30.0
+
+    devices = [EmulatedDevice(i) for i in range(count)]
+    counters = Counters()
+    stop = threading.Event()
+    server_stats(API_ENDPOINT, reset=True)
+
+    links = []
+    if mode == 'serial':
+        links = start_bridges(count)
+        targets = [(run_serial_device, (d, rate, seconds, counters, stop, links[i][0]))
+                   for i, d in enumerate(devices)]
+    else:
+        targets = [(run_http_device, (d, rate, seconds, counters, stop)) for d in devices]
+
+    print(f'{count} devices x {rate} sweeps/s ({count * rate:.0f} sweeps/s offered, {BINS} bins) '
+          f'over {mode} for {seconds:.0f} s -> {API_ENDPOINT}')
+    threads = [threading.Thread(target=f, args=a, daemon=True) for f, a in targets]
+    started = time.time()
+    for t in threads:
+        t.start()
+
+    try:
+        last = 0
+        while any(t.is_alive() for t in threads):
+            time.sleep(1.0)
+            with counters.lock:
+                sent = counters.sent
+            print(f'\r{sent} sweeps sent, {sent - last}/s', end='', flush=True)
+            last = sent
+    except KeyboardInterrupt:
+        stop.set()
+        for t in threads:
+            t.join(timeout=5)
+    elapsed = time.time() - started
+
+    if links:
+        time.sleep(2.0)  # Let the bridges drain what is still in their ptys
+        for master_fd, slave_fd, process in links:
+            process.terminate()
+            os.close(master_fd)
+            os.close(slave_fd)
+
+    print()
+    offered = counters.sent + counters.skipped
+    print(f'Offered: {offered} sweeps ({offered / elapsed:.1f} sweeps/s), '
+          f'sent: {counters.sent} ({counters.sent / elapsed:.1f} sweeps/s) in {elapsed:.1f} s, '
+          f'{counters.skipped} skipped behind schedule (dropped), {counters.failed} failed')
+    if counters.latencies:
+        print(f'Schedule to POST answer: p50 {percentile(counters.latencies, 50)} ms, '
+              f'p99 {percentile(counters.latencies, 99)} ms')
+
+    stats = server_stats(API_ENDPOINT)
+    if stats:
+        latency = stats['latencyMs']
+        lost = offered - stats['received']
+        print(f"Received: {stats['received']} sweeps ({stats['sweepsPerSec']} sweeps/s sustained), "
+              f"{lost} lost of offered ({lost / offered * 100 if offered else 0:.2f}%), "
+              f"{stats['seqGaps']} sequence gaps")
+        print(f"Ingest latency: p50 {latency['p50']} ms, p95 {latency['p95']} ms, p99 {latency['p99']} ms, "
+              f"max {latency['max']} ms")
+    else:
+        print('No /api/stats at the endpoint; run tools/local_api.py for receive-side numbers')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
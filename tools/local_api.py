@@ -0,0 +1,241 @@
+import json
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+
+# ====== CONFIGURE THESE ======
+HOST = '127.0.0.1'
+PORT = 3001
+# Latencies kept for the percentiles in /api/stats
+LATENCY_WINDOW = 20000
+# =============================
+
+USAGE = """Usage:
+  python local_api.py [port]
+
+Local stand-in for the Vercel /api/spectrum endpoint, for load tests:
+  POST /api/spectrum              same contract as the deployed API
+  GET  /api/spectrum              latest sweep (?device=<id>, ?view=devices)
+  GET  /api/stats                 ingest rate, latency percentiles, sequence gaps
+  POST /api/stats/reset           start a new measurement"""
+
+
+def now_ms():
+    return time.time() * 1000.0
+
+
+def percentile(values, p):
+    """Nearest-rank percentile, like vercel-app/lib/latency.ts."""
+    if not values:
+        return None
+    ordered = sorted(values)
+    rank = max(0, min(len(ordered) - 1, -(-p * len(ordered) // 100) - 1))
+    return round(ordered[int(rank)], 1)
+
+
+class IngestStats:
+    """Ingest counters, kept under one lock since the server is threaded.
+
+    Latency is server receipt minus the first trace stamp the sweep carries:
+    bridgeRxAt from bridge_http.py (serial line complete), or bridgePostAt
+    when a load generator posts directly. Sequence gaps per device count
+    sweeps lost anywhere upstream.
+    """
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.reset()
+
+    def reset(self):
+        with self.lock:
+            self.started = now_ms()
+            self.received = 0
+            self.rejected = 0
+            self.bytes = 0
+            self.first_rx = None
+            self.last_rx = None
+            self.latencies = []
+            self.devices = {}
+            self.latest = None
+
+    def record(self, sweep, rx_at, size):
+        with self.lock:
+            self.received += 1
+            self.bytes += size
+            if self.first_rx is None:
+                self.first_rx = rx_at
+            self.last_rx = rx_at
+            self.latest = sweep
+
+            trace = sweep.get('trace') or {}
+            sent_at = trace.get('bridgeRxAt', trace.get('bridgePostAt'))
+            if isinstance(sent_at, (int, float)):
+                self.latencies.append(rx_at - sent_at)
+                if len(self.latencies) > LATENCY_WINDOW:
+                    del self.latencies[:len(self.latencies) - LATENCY_WINDOW]
+
+            device = self.devices.setdefault(sweep['deviceId'], {
+                'sweeps': 0, 'gaps': 0, 'lastSeq': None, 'lastSeen': 0, 'latest': None
+            })
+            seq = sweep.get('seq')
+            if isinstance(seq, int) and device['lastSeq'] is not None:
+                if seq > device['lastSeq'] + 1:
+                    device['gaps'] += seq - device['lastSeq'] - 1
+            if isinstance(seq, int):
+                device['lastSeq'] = seq
+            device['sweeps'] += 1
+            device['lastSeen'] = rx_at
+            device['latest'] = sweep
+
+    def summary(self):
+        with self.lock:
+            elapsed_s = (self.last_rx - self.first_rx) / 1000.0 if self.received > 1 else 0.0
+            gaps = sum(d['gaps'] for d in self.devices.values())
+            expected = self.received + gaps
+            return {
+                'received': self.received,
+                'rejected': self.rejected,
+                'devices': len(self.devices),
+                'sweepsPerSec': round((self.received - 1) / elapsed_s, 1) if elapsed_s > 0 else 0.0,
+                'bytesPerSec': round(self.bytes / elapsed_s) if elapsed_s > 0 else 0,
+                'latencyMs': {
+                    'samples': len(self.latencies),
+                    'p50': percentile(self.latencies, 50),
+                    'p95': percentile(self.latencies, 95),
+                    'p99': percentile(self.latencies, 99),
+                    'max': round(max(self.latencies), 1) if self.latencies else None
+                },
+                'seqGaps': gaps,
+                'dropRate': round(gaps / expected, 4) if expected else 0.0
+            }
+
+
+stats = IngestStats()
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'  # Keep-alive, like the bridge's requests session would use
+    # Headers and body go out as separate writes; with Nagle on, the body waits for
+    # the client's delayed ACK and every request costs ~40 ms
+    disable_nagle_algorithm = True
+
+    def send_json(self, status, body):
+        data = json.dumps(body, separators=(',', ':')).encode()
+        self.send_response(status)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(data)))
+        self.send_header('Access-Control-Allow-Origin', '*')
+        self.end_headers()
+        self.wfile.write(data)
+
+    def do_OPTIONS(self):
+        self.send_response(200)
+        self.send_header('Access-Control-Allow-Origin', '*')
+        self.send_header('Access-Control-Allow-Methods', 'GET, POST, OPTIONS')
+        self.send_header('Access-Control-Allow-Headers', 'Content-Type')
+        self.send_header('Content-Length', '0')
+        self.end_headers()
+
+    def do_POST(self):
+        rx_at = now_ms()
+        path = urlparse(self.path).path
+        body = self.rfile.read(int(self.headers.get('Content-Length', 0)))
+
+        if path == '/api/stats/reset':
+            stats.reset()
+            self.send_json(200, {'success': True})
+            return
+        if path != '/api/spectrum':
+            self.send_json(404, {'error': 'Not found'})
+            return
+
+        # Same normalisation as ingestSweep() in vercel-app/lib/aggregator.ts
+        try:
+            payload = json.loads(body)
+            sweep = dict(payload)
+            sweep['deviceId'] = str(payload.get('deviceId', 'unknown'))
+            sweep['data'] = payload['data'] if isinstance(payload.get('data'), list) else []
+            sweep['receivedAt'] = time.strftime('%Y-%m-%dT%H:%M:%S', time.gmtime(rx_at / 1000.0)) + \
+                '.%03dZ' % (rx_at % 1000)
+            sweep['trace'] = {**(payload.get('trace') or {}), 'serverRxAt': rx_at}
+        except Exception:
+            with stats.lock:
+                stats.rejected += 1
+            self.send_json(500, {'success': False, 'error': 'Failed to process data'})
+            return
+
+        stats.record(sweep, rx_at, len(body))
+        self.send_json(200, {'success': True, 'message': 'Data received'})
+
+    def do_GET(self):
+        url = urlparse(self.path)
+        query = parse_qs(url.query)
+        if url.path == '/api/stats':
+            self.send_json(200, stats.summary())
+            return
+        if url.path != '/api/spectrum':
+            self.send_json(404, {'error': 'Not found'})
+            return
+
+        view = query.get('view', [None])[0]
+        device = query.get('device', [None])[0]
+        with stats.lock:
+            if view == 'devices':
+                body = {'devices': [
+                    {'deviceId': name, 'lastSeen': round(d['lastSeen']), 'sweeps': d['sweeps'],
+                     'seqGaps': d['gaps']}
+                    for name, d in stats.devices.items()
+                ]}
+            elif view is not None:
+                self.send_json(400, {'error': f'view={view} is not emulated locally'})
+                return
+            elif device is not None:
+                body = stats.devices.get(device, {}).get('latest')
+            else:
+                body = stats.latest
+
+        if body is None:
+            self.send_json(404, {'error': 'No data available'})
+            return
+        if 'trace' in body:
+            body = {**body, 'trace': {**body['trace'], 'servedAt': now_ms()}}
+        self.send_json(200, body)
+
+    def log_message(self, format, *args):
+        pass  # One line per request would swamp the console under load
+
+
+def main() -> int:
+    args = sys.argv[1:]
+    if len(args) > 1 or (args and not args[0].isdigit()):
+        print(USAGE)
+        return 1
+    port = int(args[0]) if args else PORT
+
+    server = ThreadingHTTPServer((HOST, port), Handler)
+    server.daemon_threads = True
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    print(f'Local API on http://{HOST}:{port}/api/spectrum (stats: /api/stats)')
+    print('Press Ctrl+C to stop.')
+    try:
+        last = 0
+        while True:
+            time.sleep(5)
+            summary = stats.summary()
+            if summary['received'] != last:
+                latency = summary['latencyMs']
+                print(f"{summary['received']} sweeps from {summary['devices']} devices, "
+                      f"{summary['sweepsPerSec']} sweeps/s, p99 {latency['p99']} ms, "
+                      f"{summary['seqGaps']} missing ({summary['dropRate'] * 100:.2f}%)")
+            last = summary['received']
+    except KeyboardInterrupt:
+        print('\nExiting...')
+    server.shutdown()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
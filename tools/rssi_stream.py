@@ -0,0 +1,81 @@
+import base64
+import csv
+import json
+import sys
+
+try:
+    import serial  # pyserial
+except Exception as e:
+    print('Missing dependency: pyserial. Install with: pip install pyserial')
+    raise
+
+
+# ====== CONFIGURE THESE ======
+SERIAL_PORT = 'COM6'
+BAUD = 115200
+# Frequency to stream (MHz); sent as 'stream <freq>' on start
+STREAM_FREQ = 868.1
+# Samples are appended here as: time_us,rssi_dbm
+CSV_PATH = 'rssi_stream.csv'
+# =============================
+
+
+def decode_block(block):
+    """Yields (time_us, rssi_dbm) for one rssiBlock line from the firmware."""
+    raw = base64.b64decode(block['samples'])
+    t = block['t0']
+    for i in range(block['n']):
+        delta = raw[i * 3] | (raw[i * 3 + 1] << 8)
+        t = (t + delta) & 0xFFFFFFFF
+        yield t, -raw[i * 3 + 2] / 2.0
+
+
+def main() -> int:
+    print(f'Opening {SERIAL_PORT} at {BAUD} baud...')
+    try:
+        ser = serial.Serial(SERIAL_PORT, BAUD, timeout=1)
+    except Exception as e:
+        print('Failed to open serial port:', e)
+        return 1
+
+    ser.write(f'stream {STREAM_FREQ}\n'.encode())
+    print(f'Streaming {STREAM_FREQ} MHz to {CSV_PATH}. Press Ctrl+C to stop.')
+
+    next_seq = None
+    lost_blocks = 0
+    samples = 0
+    with open(CSV_PATH, 'w', newline='') as f:
+        out = csv.writer(f)
+        out.writerow(['time_us', 'rssi_dbm'])
+        while True:
+            try:
+                line = ser.readline().decode('utf-8', errors='ignore').strip()
+                if not line:
+                    continue
+                if not line.startswith('{"type":"rssiBlock"'):
+                    # Burst statistics and other log lines from the device
+                    if line.startswith('['):
+                        print(line)
+                    continue
+                try:
+                    block = json.loads(line)
+                except Exception:
+                    continue
+
+                if next_seq is not None and block['seq'] != next_seq:
+                    lost_blocks += block['seq'] - next_seq
+                next_seq = block['seq'] + 1
+
+                for t, rssi in decode_block(block):
+                    out.writerow([t, rssi])
+                samples += block['n']
+            except KeyboardInterrupt:
+                break
+
+    ser.write(b'scan\n')
+    print(f'\n{samples} samples written, {lost_blocks} blocks lost on the link')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
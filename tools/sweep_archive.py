@@ -0,0 +1,379 @@
+import json
+import os
+import re
+import struct
+import sys
+import time
+from datetime import datetime
+
+
+# ====== CONFIGURE THESE ======
+# Defaults for the command line below; bridge_http.py has its own ARCHIVE_* settings
+ARCHIVE_DIR = 'archive'
+ROTATE_MB = 64              # Start a new segment once its RSSI column reaches this size
+ROTATE_S = 24 * 3600        # ... or once it is this old
+# =============================
+
+USAGE = """Usage:
+  python sweep_archive.py info [dir]
+      Lists the segments: device, span, bins, time range and sweep count.
+  python sweep_archive.py query <from> <to> [<MHz from> <MHz to>] [--device <id>] [--dir <dir>] [out.csv]
+      Slices every device's sweeps by time and frequency straight from the
+      memory-mapped columns. Prints per-frequency mean/max over the slice, or
+      with out.csv writes one row per sweep: time, seq and the RSSI per bin.
+      Times: now, 2024-05-01, 2024-05-01T08:30, epoch seconds, or -30m/-6h/-7d.
+
+Needs numpy (pip install numpy); the writer used by bridge_http.py does not."""
+
+# Layout of an archive directory:
+#
+#   index.json               closed segments: device, axis, time range, rows
+#   <device>_<epoch ms>/     one segment, a single device and frequency axis
+#     meta.json              deviceId, freq axis (MHz), creation time
+#     t.i64                  bridge receive time, epoch ms      (int64 LE)
+#     seq.u32                firmware sequence number           (uint32 LE)
+#     rssi.i16               rows x bins RSSI in 0.1 dBm        (int16 LE)
+#
+# Columns are append-only fixed-width arrays, so a segment is read by mapping
+# the files, and a torn last row after a crash is simply ignored (row count
+# is the shortest column). A segment rotates when the device's frequency axis
+# changes, or by size or age.
+
+INDEX = 'index.json'
+META = 'meta.json'
+COLUMNS = {'t': ('t.i64', '<q', 8), 'seq': ('seq.u32', '<I', 4)}
+RSSI_FILE = 'rssi.i16'
+RSSI_MISSING = -32768       # Bin without a reading
+
+
+def safe_name(device):
+    return re.sub(r'[^A-Za-z0-9_.-]', '_', device) or 'unknown'
+
+
+def load_index(root):
+    try:
+        with open(os.path.join(root, INDEX)) as f:
+            return json.load(f)['segments']
+    except (OSError, ValueError, KeyError):
+        return []
+
+
+def save_index(root, segments):
+    path = os.path.join(root, INDEX)
+    with open(path + '.tmp', 'w') as f:
+        json.dump({'version': 1, 'segments': segments}, f, indent=1)
+    os.replace(path + '.tmp', path)  # Readers never see a half-written index
+
+
+class _Segment:
+    def __init__(self, root, device, freqs, now_ms):
+        while os.path.exists(os.path.join(root, f'{safe_name(device)}_{now_ms}')):
+            now_ms += 1  # Rotated twice within a millisecond
+        self.name = f'{safe_name(device)}_{now_ms}'
+        self.path = os.path.join(root, self.name)
+        os.makedirs(self.path)
+        self.device = device
+        self.freqs = freqs
+        self.created = now_ms
+        self.first = None
+        self.last = None
+        self.rows = 0
+        with open(os.path.join(self.path, META), 'w') as f:
+            json.dump({'deviceId': device, 'freq': list(freqs), 'created': now_ms}, f)
+        self.files = {key: open(os.path.join(self.path, name), 'ab') for key, (name, _, _) in COLUMNS.items()}
+        self.files['rssi'] = open(os.path.join(self.path, RSSI_FILE), 'ab')
+        self.row = struct.Struct(f'<{len(freqs)}h')
+
+    def append(self, t_ms, seq, rssi):
+        self.files['t'].write(struct.pack('<q', t_ms))
+        self.files['seq'].write(struct.pack('<I', seq & 0xFFFFFFFF))
+        self.files['rssi'].write(self.row.pack(*rssi))
+        if self.first is None:
+            self.first = t_ms
+        self.last = t_ms
+        self.rows += 1
+
+    def entry(self):
+        return {'name': self.name, 'deviceId': self.device, 'freqBegin': self.freqs[0],
+                'freqEnd': self.freqs[-1], 'bins': len(self.freqs),
+                'first': self.first, 'last': self.last, 'rows': self.rows}
+
+    def flush(self):
+        for f in self.files.values():
+            f.flush()
+
+    def close(self):
+        for f in self.files.values():
+            f.close()
+
+
+class ArchiveWriter:
+    """Appends sweep payloads (the firmware's JSON) to per-device columnar segments.
+
+    Only the standard library, and a few small buffered writes per sweep, so
+    it can run inline in the bridge's serial loop.
+    """
+
+    def __init__(self, root, rotate_mb=ROTATE_MB, rotate_s=ROTATE_S):
+        self.root = root
+        self.rotate_bytes = rotate_mb * 1024 * 1024
+        self.rotate_ms = rotate_s * 1000
+        self.open = {}      # deviceId -> _Segment
+        self.sweeps = 0
+        self.skipped = 0    # Payloads without a usable data array
+        os.makedirs(root, exist_ok=True)
+        self.recover()
+
+    def recover(self):
+        """Indexes segments a previous run left open, cut back to their complete rows."""
+        segments = load_index(self.root)
+        known = {s['name'] for s in segments}
+        recovered = []
+        for name in sorted(os.listdir(self.root)):
+            path = os.path.join(self.root, name)
+            if name in known or not os.path.isfile(os.path.join(path, META)):
+                continue
+            with open(os.path.join(path, META)) as f:
+                meta = json.load(f)
+            bins = len(meta['freq'])
+            files = {key: (os.path.join(path, file), width) for key, (file, _, width) in COLUMNS.items()}
+            files['rssi'] = (os.path.join(path, RSSI_FILE), 2 * bins)
+            rows = min(os.path.getsize(file) // width for file, width in files.values())
+            for file, width in files.values():
+                os.truncate(file, rows * width)
+            if rows == 0:
+                continue
+            with open(files['t'][0], 'rb') as f:
+                first, = struct.unpack('<q', f.read(8))
+                f.seek((rows - 1) * 8)
+                last, = struct.unpack('<q', f.read(8))
+            recovered.append({'name': name, 'deviceId': meta['deviceId'], 'freqBegin': meta['freq'][0],
+                              'freqEnd': meta['freq'][-1], 'bins': bins,
+                              'first': first, 'last': last, 'rows': rows})
+        if recovered:
+            save_index(self.root, segments + recovered)
+
+    def append(self, payload, t_ms=None):
+        data = payload.get('data')
+        if not isinstance(data, list) or not data:
+            self.skipped += 1
+            return False
+        try:
+            freqs = tuple(round(float(p['freq']), 4) for p in data)
+        except (TypeError, KeyError, ValueError):
+            self.skipped += 1
+            return False
+        rssi = []
+        for p in data:
+            value = p.get('rssi')
+            rssi.append(max(-32767, min(32767, int(round(value * 10))))
+                        if isinstance(value, (int, float)) else RSSI_MISSING)
+
+        t_ms = int(t_ms if t_ms is not None else time.time() * 1000)
+        device = str(payload.get('deviceId', 'unknown'))
+        segment = self.open.get(device)
+        if segment and (segment.freqs != freqs
+                        or t_ms < segment.last  # Clock stepped back; keep each segment sorted by time
+                        or segment.rows * segment.row.size >= self.rotate_bytes
+                        or t_ms - segment.created >= self.rotate_ms):
+            self.close_segment(device)
+            segment = None
+        if segment is None:
+            segment = self.open[device] = _Segment(self.root, device, freqs, t_ms)
+
+        seq = payload.get('seq')
+        segment.append(t_ms, int(seq) if isinstance(seq, (int, float)) else 0, rssi)
+        self.sweeps += 1
+        return True
+
+    def close_segment(self, device):
+        segment = self.open.pop(device)
+        segment.close()
+        if segment.rows:
+            save_index(self.root, load_index(self.root) + [segment.entry()])
+
+    def flush(self):
+        for segment in self.open.values():
+            segment.flush()
+
+    def close(self):
+        for device in list(self.open):
+            self.close_segment(device)
+
+    def status(self):
+        rows = sum(s.rows for s in self.open.values())
+        return (f'Archive {self.root}: {self.sweeps} sweeps, {len(self.open)} open segments '
+                f'({rows} rows), {self.skipped} skipped')
+
+
+class ArchiveReader:
+    """Time/frequency slices of an archive as numpy arrays, without parsing sweeps."""
+
+    def __init__(self, root):
+        try:
+            import numpy as np
+        except Exception:
+            print('Missing dependency: numpy. Install with: pip install numpy')
+            raise
+        self.np = np
+        self.root = root
+
+    def segments(self):
+        """Index entries, plus the segments the writer still has open, rebuilt from their files."""
+        indexed = load_index(self.root)
+        known = {s['name'] for s in indexed}
+        found = []
+        for name in sorted(os.listdir(self.root)) if os.path.isdir(self.root) else []:
+            if name in known or not os.path.isfile(os.path.join(self.root, name, META)):
+                continue
+            with open(os.path.join(self.root, name, META)) as f:
+                meta = json.load(f)
+            columns = self.columns(name, len(meta['freq']))
+            if columns is None:
+                continue
+            t = columns[0]
+            found.append({'name': name, 'deviceId': meta['deviceId'], 'freqBegin': meta['freq'][0],
+                          'freqEnd': meta['freq'][-1], 'bins': len(meta['freq']),
+                          'first': int(t[0]), 'last': int(t[-1]), 'rows': len(t), 'open': True})
+        return indexed + found
+
+    def columns(self, name, bins):
+        """(t, seq, rssi) memory maps of one segment, cut to its complete rows; None when empty."""
+        np = self.np
+        path = os.path.join(self.root, name)
+        sizes = {key: os.path.getsize(os.path.join(path, file)) // width
+                 for key, (file, _, width) in COLUMNS.items()}
+        rows = min(sizes['t'], sizes['seq'], os.path.getsize(os.path.join(path, RSSI_FILE)) // (2 * bins))
+        if rows == 0:
+            return None
+        t = np.memmap(os.path.join(path, COLUMNS['t'][0]), dtype='<i8', mode='r', shape=(rows,))
+        seq = np.memmap(os.path.join(path, COLUMNS['seq'][0]), dtype='<u4', mode='r', shape=(rows,))
+        rssi = np.memmap(os.path.join(path, RSSI_FILE), dtype='<i2', mode='r', shape=(rows, bins))
+        return t, seq, rssi
+
+    def query(self, t_from, t_to, f_min=None, f_max=None, device=None):
+        """Yields (segment entry, t, seq, freq, rssi) per overlapping segment.
+
+        Times are epoch ms, inclusive. t and seq are 1-D, freq holds the MHz of
+        the selected bins and rssi is rows x bins int16 in 0.1 dBm
+        (RSSI_MISSING where a bin had no reading), all views on the files.
+        """
+        np = self.np
+        for entry in self.segments():
+            if device is not None and entry['deviceId'] != device:
+                continue
+            if entry['last'] < t_from or entry['first'] > t_to:
+                continue
+            with open(os.path.join(self.root, entry['name'], META)) as f:
+                freq = np.array(json.load(f)['freq'])
+            columns = self.columns(entry['name'], len(freq))
+            if columns is None:
+                continue
+            t, seq, rssi = columns
+            # Receive times only go forward within a segment, so both cuts are binary searches
+            i0, i1 = np.searchsorted(t, t_from, 'left'), np.searchsorted(t, t_to, 'right')
+            j0 = 0 if f_min is None else np.searchsorted(freq, f_min, 'left')
+            j1 = len(freq) if f_max is None else np.searchsorted(freq, f_max, 'right')
+            if i0 < i1 and j0 < j1:
+                yield entry, t[i0:i1], seq[i0:i1], freq[j0:j1], rssi[i0:i1, j0:j1]
+
+
+def parse_time(text):
+    """Epoch ms for now, -30m/-6h/-7d, epoch seconds or an ISO date/time (local time)."""
+    now = time.time()
+    if text == 'now':
+        return int(now * 1000)
+    relative = re.fullmatch(r'-(\d+(?:\.\d+)?)([smhd])', text)
+    if relative:
+        scale = {'s': 1, 'm': 60, 'h': 3600, 'd': 86400}[relative.group(2)]
+        return int((now - float(relative.group(1)) * scale) * 1000)
+    try:
+        return int(float(text) * 1000)
+    except ValueError:
+        return int(datetime.fromisoformat(text).timestamp() * 1000)
+
+
+def fmt_time(ms):
+    return datetime.fromtimestamp(ms / 1000).strftime('%Y-%m-%d %H:%M:%S')
+
+
+def info(root):
+    reader = ArchiveReader(root)
+    segments = reader.segments()
+    if not segments:
+        print(f'No segments in {root}')
+        return 0
+    for s in segments:
+        print(f"{s['name']}: {s['deviceId']} {s['freqBegin']}-{s['freqEnd']} MHz x {s['bins']}, "
+              f"{fmt_time(s['first'])} .. {fmt_time(s['last'])}, {s['rows']} sweeps"
+              + (' (open)' if s.get('open') else ''))
+    print(f"{len(segments)} segments, {sum(s['rows'] for s in segments)} sweeps")
+    return 0
+
+
+def query(root, args):
+    device = None
+    if '--device' in args:
+        i = args.index('--device')
+        device = args[i + 1]
+        del args[i:i + 2]
+    if '--dir' in args:
+        i = args.index('--dir')
+        root = args[i + 1]
+        del args[i:i + 2]
+    out_path = args.pop() if args and args[-1].endswith('.csv') else None
+    if len(args) not in (2, 4):
+        print(USAGE)
+        return 1
+    t_from, t_to = parse_time(args[0]), parse_time(args[1])
+    f_min, f_max = (float(args[2]), float(args[3])) if len(args) == 4 else (None, None)
+
+    reader = ArchiveReader(root)
+    np = reader.np
+    started = time.time()
+    out = open(out_path, 'w') if out_path else None
+    sweeps = 0
+    summary = {}   # (deviceId, freq axis) -> [sum, count, max] per bin
+    CHUNK = 65536  # Rows per pass, so a long slice never has to fit in memory as floats
+    for entry, t, seq, freq, rssi in reader.query(t_from, t_to, f_min, f_max, device):
+        sweeps += len(t)
+        if out:
+            out.write('# ' + entry['deviceId'] + '\n')
+            out.write('time,seq,' + ','.join(f'{f:g}' for f in freq) + '\n')
+            for i in range(len(t)):
+                values = ','.join('' if v == RSSI_MISSING else f'{v / 10:.1f}' for v in rssi[i].tolist())
+                out.write(f'{fmt_time(int(t[i]))},{int(seq[i])},{values}\n')
+            continue
+        key = (entry['deviceId'], tuple(freq.tolist()))
+        acc = summary.setdefault(key, [np.zeros(len(freq)), np.zeros(len(freq)), np.full(len(freq), -np.inf)])
+        for start in range(0, len(t), CHUNK):
+            block = np.asarray(rssi[start:start + CHUNK])
+            valid = block != RSSI_MISSING
+            acc[0] += np.where(valid, block, 0).sum(axis=0)
+            acc[1] += valid.sum(axis=0)
+            acc[2] = np.maximum(acc[2], np.where(valid, block, -32768).max(axis=0))
+    if out:
+        out.close()
+
+    print(f'{sweeps} sweeps between {fmt_time(t_from)} and {fmt_time(t_to)} '
+          f'in {(time.time() - started) * 1000:.0f} ms' + (f', written to {out_path}' if out_path else ''))
+    for (device_id, freq), (total, count, peak) in summary.items():
+        print(f'\n{device_id}\n  MHz        mean dBm   max dBm')
+        for i, f in enumerate(freq):
+            if count[i]:
+                print(f'  {f:<10g} {total[i] / count[i] / 10:8.1f}  {peak[i] / 10:8.1f}')
+    return 0
+
+
+def main() -> int:
+    args = sys.argv[1:]
+    if args and args[0] == 'info' and len(args) <= 2:
+        return info(args[1] if len(args) == 2 else ARCHIVE_DIR)
+    if args and args[0] == 'query':
+        return query(ARCHIVE_DIR, args[1:])
+    print(USAGE)
+    return 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,146 @@
+import json
+import struct
+import sys
+import time
+
+try:
+    import serial  # pyserial
+except Exception as e:
+    print('Missing dependency: pyserial. Install with: pip install pyserial')
+    raise
+
+
+# ====== CONFIGURE THESE ======
+SERIAL_PORT = 'COM6'
+BAUD = 115200
+# Seconds to wait for the device to echo a replayed sweep before sending the next
+REPLAY_TIMEOUT = 5.0
+# =============================
+
+USAGE = """Usage:
+  python sweep_capture.py record <capture.jsonl>      Save the device's sweep snapshots
+  python sweep_capture.py convert <in.jsonl> <out.bin> JSON lines to the binary format
+  python sweep_capture.py send <capture> [fast]        Replay a capture over serial
+
+A binary capture can also be copied to the device's LittleFS (data/ folder,
+'pio run -t uploadfs') and replayed there with 'replay <file> fast'."""
+
+BINARY_MAGIC = b'SWP1'
+
+
+def is_sweep(line):
+    return line.startswith('{') and '"data"' in line
+
+
+def read_sweeps(path):
+    """Yields (timestamp, freq_begin, freq_end, [rssi]) from a JSON or binary capture."""
+    with open(path, 'rb') as f:
+        if f.read(4) == BINARY_MAGIC:
+            while True:
+                header = f.read(14)
+                if len(header) < 14:
+                    return
+                timestamp, begin, end, bins = struct.unpack('<IffH', header)
+                rssi = struct.unpack(f'<{bins}h', f.read(2 * bins))
+                yield timestamp, begin, end, [r / 10.0 for r in rssi]
+        f.seek(0)
+        for raw in f:
+            line = raw.decode('utf-8', errors='ignore').strip()
+            if not is_sweep(line):
+                continue
+            try:
+                sweep = json.loads(line)
+            except Exception:
+                continue
+            yield (sweep.get('timestamp', 0), sweep['freqBegin'], sweep['freqEnd'],
+                   [point['rssi'] for point in sweep['data']])
+
+
+def sweep_line(timestamp, begin, end, rssi):
+    """The subset of a firmware snapshot that replay reads."""
+    return json.dumps({
+        'timestamp': timestamp, 'freqBegin': begin, 'freqEnd': end,
+        'data': [{'rssi': round(r, 1)} for r in rssi]
+    }, separators=(',', ':'))
+
+
+def open_serial():
+    print(f'Opening {SERIAL_PORT} at {BAUD} baud...')
+    return serial.Serial(SERIAL_PORT, BAUD, timeout=1)
+
+
+def record(path):
+    ser = open_serial()
+    count = 0
+    print(f'Recording sweeps to {path}. Press Ctrl+C to stop.')
+    with open(path, 'w') as out:
+        while True:
+            try:
+                line = ser.readline().decode('utf-8', errors='ignore').strip()
+                if is_sweep(line):
+                    out.write(line + '\n')
+                    count += 1
+                    if count % 10 == 0:
+                        print(f'\r{count} sweeps', end='', flush=True)
+            except KeyboardInterrupt:
+                break
+    print(f'\n{count} sweeps recorded')
+
+
+def convert(src, dst):
+    count = 0
+    with open(dst, 'wb') as out:
+        out.write(BINARY_MAGIC)
+        for timestamp, begin, end, rssi in read_sweeps(src):
+            out.write(struct.pack('<IffH', int(timestamp) & 0xFFFFFFFF, begin, end, len(rssi)))
+            out.write(struct.pack(f'<{len(rssi)}h', *(int(round(r * 10)) for r in rssi)))
+            count += 1
+    print(f'{count} sweeps written to {dst}')
+
+
+def send(path, fast):
+    """Lockstep replay: each sweep is sent once the device has emitted the previous one."""
+    ser = open_serial()
+    ser.write(b'replay serial fast\n' if fast else b'replay serial\n')
+    time.sleep(0.2)
+    ser.reset_input_buffer()
+
+    sent = 0
+    start = time.time()
+    try:
+        for sweep in read_sweeps(path):
+            ser.write((sweep_line(*sweep) + '\n').encode())
+            sent += 1
+            deadline = time.time() + REPLAY_TIMEOUT
+            while time.time() < deadline:
+                line = ser.readline().decode('utf-8', errors='ignore').strip()
+                if is_sweep(line):
+                    break
+                if line:
+                    print(line)
+            else:
+                print(f'No snapshot for sweep {sent}, continuing')
+    except KeyboardInterrupt:
+        pass
+
+    ser.write(b'noreplay\n')
+    elapsed = time.time() - start
+    print(f'{sent} sweeps replayed in {elapsed:.1f} s ({sent / elapsed if elapsed else 0:.1f} sweeps/s)')
+
+
+def main() -> int:
+    args = sys.argv[1:]
+    if len(args) == 2 and args[0] == 'record':
+        record(args[1])
+    elif len(args) == 3 and args[0] == 'convert':
+        convert(args[1], args[2])
+    elif len(args) in (2, 3) and args[0] == 'send':
+        send(args[1], len(args) == 3 and args[2] == 'fast')
+    else:
+        print(USAGE)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,187 @@
+import json
+import socket
+import struct
+import sys
+import time
+
+
+# ====== CONFIGURE THESE ======
+# Must match UDP_GROUP / UDP_PORT in wifi_spectrum.cpp
+UDP_GROUP = '239.10.0.1'
+UDP_PORT = 5005
+# Local interface address to join the group on ('0.0.0.0' = let the OS pick)
+INTERFACE = '0.0.0.0'
+# A sweep still missing fragments this long after its first one counts as incomplete
+REASSEMBLY_TIMEOUT_S = 2.0
+# A sweep this many sequence numbers behind the newest, or started this long before it,
+# is taken as a board restart (udpSeq and millis() begin again), not a reordered datagram
+RESTART_SEQ_JUMP = 64
+RESTART_TIME_JUMP_S = REASSEMBLY_TIMEOUT_S
+# Seconds between loss reports
+REPORT_INTERVAL_S = 5.0
+# =============================
+
+USAGE = """Usage:
+  python udp_listen.py [out.jsonl]
+      Joins UDP_GROUP:UDP_PORT, rebuilds the sweeps sent by wifi_spectrum.cpp
+      and prints per-device rate and loss every REPORT_INTERVAL_S. With a file
+      name, complete sweeps are also appended there as the firmware's JSON."""
+
+MAGIC = b'SWU1'
+HEADER = struct.Struct('<4s6sIIIffHBBHH')  # UdpSweepHeader in wifi_spectrum.cpp
+
+
+def open_socket():
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)  # Ride out bursts from many boards
+    sock.bind(('', UDP_PORT))
+    if socket.inet_aton(UDP_GROUP)[0] >> 4 == 14:  # 224.0.0.0/4: join, otherwise broadcast/unicast
+        membership = socket.inet_aton(UDP_GROUP) + socket.inet_aton(INTERFACE)
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+    sock.settimeout(0.5)
+    return sock
+
+
+def parse(datagram):
+    """Header fields and RSSI values (dBm) of one datagram, or None if it isn't ours."""
+    if len(datagram) < HEADER.size or datagram[:4] != MAGIC:
+        return None
+    magic, mac, seq, start, end, begin, stop, bins, fragment, fragments, first, count = \
+        HEADER.unpack_from(datagram)
+    if len(datagram) != HEADER.size + 2 * count or first + count > bins:
+        return None
+    rssi = struct.unpack_from(f'<{count}h', datagram, HEADER.size)
+    return {
+        'deviceId': ':'.join(f'{b:02X}' for b in mac),
+        'seq': seq, 'sweepStart': start, 'sweepEnd': end,
+        'freqBegin': begin, 'freqEnd': stop, 'freqSteps': bins,
+        'fragment': fragment, 'fragments': fragments,
+        'firstBin': first, 'rssi': [r / 10.0 for r in rssi]
+    }
+
+
+class Device:
+    """Reassembly and loss accounting for one board."""
+
+    def __init__(self):
+        self.pending = {}      # seq -> [first arrival, rssi per bin, fragments seen]
+        self.next_seq = None
+        self.last_start = 0    # sweepStart (device millis) of the newest sweep
+        self.restarts = 0
+        self.complete = 0
+        self.incomplete = 0    # Sweeps with some fragments lost
+        self.lost = 0          # Sweeps with every fragment lost (sequence gaps)
+        self.late = 0          # Arrived after a newer sweep; reordered by the network
+        self.duplicate = 0
+        self.window_complete = 0
+
+    def add(self, part, now):
+        seq = part['seq']
+        if self.next_seq is not None and seq < self.next_seq and seq not in self.pending and \
+                (self.next_seq - seq > RESTART_SEQ_JUMP or
+                 part['sweepStart'] + RESTART_TIME_JUMP_S * 1000 < self.last_start):
+            # The board rebooted; sweeps of the old run still waiting for fragments never will
+            self.restarts += 1
+            self.incomplete += len(self.pending)
+            self.pending.clear()
+            self.lost += seq - 1  # New run's sweeps before this one
+            self.next_seq = seq + 1
+            self.last_start = part['sweepStart']
+        elif self.next_seq is None or seq >= self.next_seq:
+            if self.next_seq is not None:
+                self.lost += seq - self.next_seq
+            self.next_seq = seq + 1
+            self.last_start = part['sweepStart']
+        elif seq not in self.pending:
+            if self.lost > 0:
+                self.lost -= 1  # Counted as a gap before it showed up
+            self.late += 1
+
+        entry = self.pending.setdefault(seq, [now, [None] * part['freqSteps'], set()])
+        if part['fragment'] in entry[2]:
+            self.duplicate += 1
+            return None
+        entry[2].add(part['fragment'])
+        entry[1][part['firstBin']:part['firstBin'] + len(part['rssi'])] = part['rssi']
+        if len(entry[2]) < part['fragments']:
+            return None
+
+        del self.pending[seq]
+        self.complete += 1
+        self.window_complete += 1
+        step = (part['freqEnd'] - part['freqBegin']) / part['freqSteps']
+        return {
+            'timestamp': part['sweepEnd'], 'deviceId': part['deviceId'], 'seq': seq,
+            'sweepStart': part['sweepStart'], 'sweepEnd': part['sweepEnd'],
+            'freqBegin': part['freqBegin'], 'freqEnd': part['freqEnd'], 'freqSteps': part['freqSteps'],
+            'data': [{'freq': round(part['freqBegin'] + (i + 0.5) * step, 4), 'rssi': r}
+                     for i, r in enumerate(entry[1])]
+        }
+
+    def expire(self, now):
+        for seq in [s for s, e in self.pending.items() if now - e[0] > REASSEMBLY_TIMEOUT_S]:
+            del self.pending[seq]
+            self.incomplete += 1
+
+
+def report(devices, elapsed):
+    for device_id, d in sorted(devices.items()):
+        total = d.complete + d.incomplete + d.lost
+        loss = (d.incomplete + d.lost) / total * 100 if total else 0.0
+        print(f'{device_id}: {d.window_complete / elapsed:.1f} sweeps/s, {d.complete} complete, '
+              f'{d.lost} lost, {d.incomplete} incomplete ({loss:.2f}% loss), '
+              f'{d.late} reordered, {d.duplicate} duplicate fragments, {d.restarts} restarts')
+        d.window_complete = 0
+
+
+def main() -> int:
+    args = sys.argv[1:]
+    if len(args) > 1 or (args and args[0] in ('-h', '--help')):
+        print(USAGE)
+        return 1
+
+    try:
+        sock = open_socket()
+    except OSError as e:
+        print(f'Failed to listen on {UDP_GROUP}:{UDP_PORT}:', e)
+        return 1
+    out = open(args[0], 'a') if args else None
+    print(f'Listening on {UDP_GROUP}:{UDP_PORT}. Press Ctrl+C to stop.')
+
+    devices = {}
+    last_report = time.time()
+    try:
+        while True:
+            try:
+                datagram, _ = sock.recvfrom(65536)
+            except socket.timeout:
+                datagram = None
+            now = time.time()
+
+            part = parse(datagram) if datagram else None
+            if part:
+                sweep = devices.setdefault(part['deviceId'], Device()).add(part, now)
+                if sweep and out:
+                    out.write(json.dumps(sweep, separators=(',', ':')) + '\n')
+
+            if now - last_report >= REPORT_INTERVAL_S:
+                for d in devices.values():
+                    d.expire(now)
+                report(devices, now - last_report)
+                last_report = now
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if out:
+            out.close()
+
+    for d in devices.values():
+        d.expire(float('inf'))
+    print()
+    report(devices, max(time.time() - last_report, 1e-3))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,320 @@
+// Per-device spectrum state and merged multi-node views
+//
+// Each analyzer keeps its own short history. Sweeps are placed on a common
+// server timeline by estimating each device's millis() offset, so views can
+// pick the sweep from every node that is closest to the same instant. Longer
+// history lives in the rollups (lib/rollup.ts), fed from here.
+
+import { recordRollup } from './rollup';
+
+export interface SpectrumDataPoint {
+  freq: number;
+  rssi: number;
+}
+
+// Latency trace stamps (ms epoch unless noted), added along the pipeline
+export interface SweepTrace {
+  bridgeRxAt?: number;    // Serial line complete at the bridge
+  serialMs?: number;      // Bridge estimate of device-to-bridge latency (ms)
+  bridgePostAt?: number;  // Bridge starts the HTTP POST
+  serverRxAt: number;     // API received the POST
+  servedAt?: number;      // API answered the GET that returned this sweep
+}
+
+export interface SpectrumSweep {
+  timestamp: number;
+  deviceId: string;
+  seq?: number;
+  sweepStart?: number;    // Device millis()
+  sweepEnd?: number;      // Device millis()
+  trace?: SweepTrace;
+  freqBegin: number;
+  freqEnd: number;
+  freqSteps: number;
+  data: SpectrumDataPoint[];
+  receivedAt: string;
+  [key: string]: any;
+}
+
+export interface MergedDataPoint extends SpectrumDataPoint {
+  deviceId: string;  // Node that contributed the maximum
+}
+
+export interface AlignedDevice {
+  deviceId: string;
+  sweepTime: number;  // Estimated sweep time on the server clock (ms epoch)
+  skewMs: number;     // sweepTime minus the alignment instant
+}
+
+export interface MergedSweep {
+  deviceId: 'merged';
+  timestamp: number;
+  freqBegin: number;
+  freqEnd: number;
+  freqSteps: number;
+  data: MergedDataPoint[];
+  aligned: AlignedDevice[];     // Nodes that contributed to this view
+  devices: DeviceSummary[];     // Every known node, for status displays
+  receivedAt: string;
+  // Trace fields of the newest contributing sweep
+  seq?: number;
+  sweepStart?: number;
+  sweepEnd?: number;
+  trace?: SweepTrace;
+}
+
+export interface OverlaySweep {
+  timestamp: number;
+  aligned: AlignedDevice[];
+  data: { freq: number; values: Record<string, number> }[];
+}
+
+export interface DeviceSummary {
+  deviceId: string;
+  lastSeen: number;      // Server ms epoch of the latest sweep; the page derives the age
+  ratePerSec: number;
+  sweeps: number;
+  freqBegin: number;
+  freqEnd: number;
+  freqSteps: number;
+  occupancy?: OccupancyReport;  // Latest device-side occupancy report
+}
+
+// Computed on the device over its own bins; see lib/spectrum_occupancy
+export interface OccupancyReport {
+  threshold: number;
+  windows: {
+    seconds: number;
+    slots: number;
+    busy: number[];       // Percent per bin, -1 = no data
+    bursts: number[];
+    dwellHist: number[];
+  }[];
+  receivedAt: string;
+}
+
+const HISTORY_PER_DEVICE = 32;       // Sweeps kept per device for alignment
+const DEVICE_STALE_MS = 60_000;      // Devices this far behind the newest sweep are left out of merged views
+const DEFAULT_TOLERANCE_MS = 2_000;  // Max distance from the alignment instant
+const RATE_SMOOTHING = 0.2;          // EWMA weight of the newest inter-arrival
+
+interface StoredSweep {
+  sweep: SpectrumSweep;
+  sweepTime: number;
+}
+
+interface DeviceState {
+  deviceId: string;
+  history: StoredSweep[];
+  lastSeen: number;
+  lastDeviceTimestamp: number;
+  clockOffsetMs: number | null;   // server ms - device millis(), minimum seen
+  intervalEwmaMs: number | null;
+  sweeps: number;
+  occupancy?: OccupancyReport;
+}
+
+// In-memory storage (for demo - use database in production)
+const devices = new Map<string, DeviceState>();
+let latestSweep: SpectrumSweep | null = null;
+let ingestSeq = 0;  // Sweeps ingested since start, versions every view for ETags
+// ingestSeq restarts with the process and differs per serverless instance; ETags
+// carry this too so a tag from another instance or an earlier boot never matches
+export const BOOT_ID = Date.now().toString(36) + Math.random().toString(36).slice(2, 8);
+let lastIngestAt = 0;  // Server ms of the newest sweep; staleness is measured from it
+
+export function ingestSweep(body: any, now: number = Date.now()): SpectrumSweep {
+  const sweep: SpectrumSweep = {
+    ...body,
+    deviceId: String(body?.deviceId ?? 'unknown'),
+    data: Array.isArray(body?.data) ? body.data : [],
+    receivedAt: new Date(now).toISOString(),
+    trace: { ...body?.trace, serverRxAt: now }
+  };
+
+  let state = devices.get(sweep.deviceId);
+  if (!state) {
+    state = {
+      deviceId: sweep.deviceId,
+      history: [],
+      lastSeen: now,
+      lastDeviceTimestamp: 0,
+      clockOffsetMs: null,
+      intervalEwmaMs: null,
+      sweeps: 0
+    };
+    devices.set(sweep.deviceId, state);
+  } else {
+    const interval = now - state.lastSeen;
+    state.intervalEwmaMs = state.intervalEwmaMs === null
+      ? interval
+      : state.intervalEwmaMs + RATE_SMOOTHING * (interval - state.intervalEwmaMs);
+  }
+
+  // Transport delay is always positive, so the smallest offset seen is the
+  // best estimate. A device timestamp going backwards means it rebooted.
+  const deviceTime = Number(sweep.timestamp);
+  if (Number.isFinite(deviceTime)) {
+    const offset = now - deviceTime;
+    if (state.clockOffsetMs === null || deviceTime < state.lastDeviceTimestamp || offset < state.clockOffsetMs) {
+      state.clockOffsetMs = offset;
+    }
+    state.lastDeviceTimestamp = deviceTime;
+  }
+  const sweepTime = state.clockOffsetMs !== null && Number.isFinite(deviceTime)
+    ? deviceTime + state.clockOffsetMs
+    : now;
+
+  recordRollup(sweep.deviceId, Number(sweep.freqBegin), Number(sweep.freqEnd),
+    sweep.data.map(point => Number(point.rssi)), sweepTime);
+
+  state.history.push({ sweep, sweepTime });
+  if (state.history.length > HISTORY_PER_DEVICE) {
+    state.history.shift();
+  }
+  if (body?.occupancy && Array.isArray(body.occupancy.windows)) {
+    state.occupancy = { ...body.occupancy, receivedAt: sweep.receivedAt };
+  }
+  state.lastSeen = now;
+  state.sweeps++;
+  latestSweep = sweep;
+  lastIngestAt = Math.max(lastIngestAt, now);
+  ingestSeq++;
+  return sweep;
+}
+
+// Changes whenever a sweep arrives (from `deviceId`, if given)
+export function getIngestSeq(deviceId?: string): number {
+  if (deviceId === undefined) return ingestSeq;
+  const state = devices.get(deviceId);
+  return state ? state.sweeps : 0;
+}
+
+export function getLatestSweep(deviceId?: string): SpectrumSweep | null {
+  if (deviceId === undefined) return latestSweep;
+  const state = devices.get(deviceId);
+  return state ? state.history[state.history.length - 1].sweep : null;
+}
+
+// Views only change when a sweep arrives, so ingestSeq alone can version them
+export function getDeviceSummaries(): DeviceSummary[] {
+  return Array.from(devices.values()).map(state => {
+    const last = state.history[state.history.length - 1].sweep;
+    return {
+      deviceId: state.deviceId,
+      lastSeen: state.lastSeen,
+      ratePerSec: state.intervalEwmaMs ? 1000 / state.intervalEwmaMs : 0,
+      sweeps: state.sweeps,
+      freqBegin: last.freqBegin,
+      freqEnd: last.freqEnd,
+      freqSteps: last.freqSteps,
+      occupancy: state.occupancy
+    };
+  });
+}
+
+// Pick, for every live device, the stored sweep closest to `at`. With no `at`
+// the newest sweep time across devices is used.
+function alignSweeps(at: number | undefined, toleranceMs: number) {
+  const live = Array.from(devices.values()).filter(s => lastIngestAt - s.lastSeen <= DEVICE_STALE_MS);
+  const instant = at ?? Math.max(...live.map(s => s.history[s.history.length - 1].sweepTime));
+
+  const aligned: { stored: StoredSweep; info: AlignedDevice }[] = [];
+  for (const state of live) {
+    let best: StoredSweep | null = null;
+    for (const stored of state.history) {
+      if (!best || Math.abs(stored.sweepTime - instant) < Math.abs(best.sweepTime - instant)) {
+        best = stored;
+      }
+    }
+    if (best && Math.abs(best.sweepTime - instant) <= toleranceMs) {
+      aligned.push({
+        stored: best,
+        info: { deviceId: state.deviceId, sweepTime: best.sweepTime, skewMs: best.sweepTime - instant }
+      });
+    }
+  }
+  return { instant, aligned };
+}
+
+// Nearest bin of a sweep to `freq`, or undefined outside the sweep's span
+function sampleAt(points: SpectrumDataPoint[], freq: number): number | undefined {
+  if (points.length === 0) return undefined;
+  const halfStep = points.length > 1 ? (points[1].freq - points[0].freq) / 2 : 0;
+  if (freq < points[0].freq - halfStep || freq > points[points.length - 1].freq + halfStep) {
+    return undefined;
+  }
+  let lo = 0;
+  let hi = points.length - 1;
+  while (lo < hi) {
+    const mid = (lo + hi) >> 1;
+    if (points[mid].freq < freq) lo = mid + 1; else hi = mid;
+  }
+  if (lo > 0 && freq - points[lo - 1].freq < points[lo].freq - freq) lo--;
+  return points[lo].rssi;
+}
+
+// Frequency grid of the finest aligned sweep
+function referenceGrid(aligned: { stored: StoredSweep }[]): SpectrumSweep {
+  return aligned.reduce((a, b) => (b.stored.sweep.data.length > a.stored.sweep.data.length ? b : a))
+    .stored.sweep;
+}
+
+export function getMergedView(
+  at?: number,
+  toleranceMs: number = DEFAULT_TOLERANCE_MS
+): MergedSweep | null {
+  const { instant, aligned } = alignSweeps(at, toleranceMs);
+  if (aligned.length === 0) return null;
+
+  const grid = referenceGrid(aligned);
+  const newest = aligned.reduce((a, b) => (b.stored.sweepTime > a.stored.sweepTime ? b : a)).stored.sweep;
+  const data: MergedDataPoint[] = grid.data.map(point => {
+    let rssi = -Infinity;
+    let deviceId = grid.deviceId;
+    for (const { stored, info } of aligned) {
+      const value = sampleAt(stored.sweep.data, point.freq);
+      if (value !== undefined && value > rssi) {
+        rssi = value;
+        deviceId = info.deviceId;
+      }
+    }
+    return { freq: point.freq, rssi, deviceId };
+  });
+
+  return {
+    deviceId: 'merged',
+    timestamp: instant,
+    freqBegin: grid.freqBegin,
+    freqEnd: grid.freqEnd,
+    freqSteps: data.length,
+    data,
+    aligned: aligned.map(a => a.info),
+    devices: getDeviceSummaries(),
+    receivedAt: newest.receivedAt,
+    seq: newest.seq,
+    sweepStart: newest.sweepStart,
+    sweepEnd: newest.sweepEnd,
+    trace: newest.trace
+  };
+}
+
+export function getOverlayView(
+  at?: number,
+  toleranceMs: number = DEFAULT_TOLERANCE_MS
+): OverlaySweep | null {
+  const { instant, aligned } = alignSweeps(at, toleranceMs);
+  if (aligned.length === 0) return null;
+
+  const grid = referenceGrid(aligned);
+  const data = grid.data.map(point => {
+    const values: Record<string, number> = {};
+    for (const { stored, info } of aligned) {
+      const value = sampleAt(stored.sweep.data, point.freq);
+      if (value !== undefined) values[info.deviceId] = value;
+    }
+    return { freq: point.freq, values };
+  });
+
+  return { timestamp: instant, aligned: aligned.map(a => a.info), data };
+}
@@ -0,0 +1,75 @@
+// Compact columnar form of the spectrum views (`?format=columnar`)
+//
+// The default payload repeats `{"freq":..,"rssi":..}` for every bin; here
+// each field is one array, and the merged view's contributing node is an
+// index into `sources`. Shared by the API (encode) and the page (decode), so
+// it must stay free of Node-only imports.
+
+import type { SpectrumDataPoint } from './aggregator';
+
+export interface ColumnarSweep {
+  format: 'columnar';
+  freq: number[];
+  rssi: number[];
+  sources?: string[];  // Merged view: node per `source` index
+  source?: number[];
+  [key: string]: any;
+}
+
+export interface ColumnarOverlay {
+  format: 'columnar';
+  freq: number[];
+  values: Record<string, (number | null)[]>;  // Per node; null where it has no bin
+  [key: string]: any;
+}
+
+// Sweep-like bodies (latest, device, merged) and the overlay view; anything
+// without a `data` array (e.g. ?view=devices) is returned unchanged
+export function toColumnar(body: any): any {
+  if (!body || !Array.isArray(body.data)) return body;
+  const { data, ...rest } = body;
+  const freq = data.map((p: any) => p.freq);
+
+  if (data.length > 0 && data[0].values !== undefined) {
+    const values: Record<string, (number | null)[]> = {};
+    data.forEach((p: any, i: number) => {
+      Object.keys(p.values).forEach(id => {
+        if (!values[id]) values[id] = data.map(() => null);
+        values[id][i] = p.values[id];
+      });
+    });
+    return { ...rest, format: 'columnar', freq, values } as ColumnarOverlay;
+  }
+
+  const out: ColumnarSweep = { ...rest, format: 'columnar', freq, rssi: data.map((p: any) => p.rssi) };
+  if (data.length > 0 && data[0].deviceId !== undefined) {
+    const sources: string[] = [];
+    out.source = data.map((p: any) => {
+      let index = sources.indexOf(p.deviceId);
+      if (index < 0) index = sources.push(p.deviceId) - 1;
+      return index;
+    });
+    out.sources = sources;
+  }
+  return out;
+}
+
+// Back to `data` points, for code written against the default payload
+export function fromColumnar(body: any): any {
+  if (!body || body.format !== 'columnar' || !Array.isArray(body.freq)) return body;
+  const { format, freq, rssi, sources, source, values, ...rest } = body;
+  if (values) {
+    const data = freq.map((f: number, i: number) => {
+      const point: Record<string, number> = {};
+      Object.keys(values).forEach(id => {
+        if (values[id][i] !== null) point[id] = values[id][i];
+      });
+      return { freq: f, values: point };
+    });
+    return { ...rest, data };
+  }
+  const data: (SpectrumDataPoint & { deviceId?: string })[] = freq.map((f: number, i: number) => (
+    source ? { freq: f, rssi: rssi[i], deviceId: sources[source[i]] } : { freq: f, rssi: rssi[i] }
+  ));
+  return { ...rest, data };
+}
@@ -0,0 +1,61 @@
+// Latency breakdown from RSSI sweep to browser paint
+//
+// Stages measured on one clock are exact; `http` crosses from the bridge PC
+// clock to the server clock and is only as good as their NTP sync.
+
+import type { SweepTrace } from './aggregator';
+
+export const LATENCY_STAGES = [
+  'sweep',     // Device: first bin to last bin
+  'emit',      // Device: end of sweep to JSON timestamp
+  'serial',    // Device to bridge (bridge estimate)
+  'bridge',    // Bridge: line received to POST start
+  'http',      // Bridge POST start to API receipt
+  'pollWait',  // API receipt to the GET that served it
+  'fetch',     // Browser: GET request to response parsed
+  'render'     // Browser: response parsed to next paint
+] as const;
+
+export type LatencyStage = typeof LATENCY_STAGES[number];
+export type LatencySample = Partial<Record<LatencyStage | 'total', number>>;
+
+export interface TracedSweep {
+  timestamp: number;
+  sweepStart?: number;
+  sweepEnd?: number;
+  trace?: SweepTrace;
+}
+
+// `fetchStart`, `fetchEnd` and `paintAt` come from performance.now()
+export function latencyBreakdown(
+  sweep: TracedSweep,
+  fetchStart: number,
+  fetchEnd: number,
+  paintAt: number
+): LatencySample {
+  const t = sweep.trace;
+  const sample: LatencySample = {};
+  if (sweep.sweepStart !== undefined && sweep.sweepEnd !== undefined) {
+    sample.sweep = sweep.sweepEnd - sweep.sweepStart;
+    sample.emit = sweep.timestamp - sweep.sweepEnd;
+  }
+  if (t?.serialMs !== undefined) sample.serial = t.serialMs;
+  if (t?.bridgeRxAt !== undefined && t.bridgePostAt !== undefined) {
+    sample.bridge = t.bridgePostAt - t.bridgeRxAt;
+  }
+  if (t?.bridgePostAt !== undefined) sample.http = t.serverRxAt - t.bridgePostAt;
+  if (t?.servedAt !== undefined) sample.pollWait = t.servedAt - t.serverRxAt;
+  sample.fetch = fetchEnd - fetchStart;
+  sample.render = paintAt - fetchEnd;
+
+  sample.total = LATENCY_STAGES.reduce((sum, stage) => sum + (sample[stage] ?? 0), 0);
+  return sample;
+}
+
+// Nearest-rank percentile, `p` in 0..100
+export function percentile(values: number[], p: number): number {
+  if (values.length === 0) return NaN;
+  const sorted = [...values].sort((a, b) => a - b);
+  const rank = Math.ceil((p / 100) * sorted.length) - 1;
+  return sorted[Math.min(sorted.length - 1, Math.max(0, rank))];
+}
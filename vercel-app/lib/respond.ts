@@ -0,0 +1,68 @@
+// JSON responses with conditional GET and compression
+//
+// Views carry a weak ETag built from the ingest sequence, so a poll that
+// finds nothing new is answered with 304 before the view is even built.
+// Bodies are brotli- or gzip-compressed according to Accept-Encoding; sweep
+// JSON is mostly repeated keys and digits and shrinks several times over.
+
+import type { NextApiRequest, NextApiResponse } from 'next';
+import { brotliCompressSync, constants as zlibConstants, gzipSync } from 'zlib';
+
+const COMPRESS_MIN_BYTES = 1024;  // Smaller bodies are sent as they are
+const BROTLI_QUALITY = 5;         // Better ratio than gzip -6 at similar speed; 11 is far slower
+const GZIP_LEVEL = 6;
+
+type Encoding = 'br' | 'gzip' | null;
+
+// If-None-Match may list several tags or `*`; weak and strong forms compare equal
+export function etagMatches(req: NextApiRequest, etag: string): boolean {
+  const header = req.headers['if-none-match'];
+  if (!header) return false;
+  const opaque = (tag: string) => tag.trim().replace(/^W\//, '');
+  return header.split(',').some(tag => tag.trim() === '*' || opaque(tag) === opaque(etag));
+}
+
+// Answers 304 when the client already has `etag`; otherwise only sets the
+// caching headers and leaves the response to the caller
+export function notModified(req: NextApiRequest, res: NextApiResponse, etag: string): boolean {
+  res.setHeader('ETag', etag);
+  res.setHeader('Cache-Control', 'no-cache');  // Cache, but revalidate every time
+  if (!etagMatches(req, etag)) return false;
+  res.status(304).end();
+  return true;
+}
+
+function acceptedEncoding(req: NextApiRequest): Encoding {
+  const header = String(req.headers['accept-encoding'] ?? '').toLowerCase();
+  const accepts = (name: string) => header.split(',').some(part => {
+    const [token, ...params] = part.split(';');
+    return token.trim() === name && !params.some(p => /^\s*q=0(\.0*)?\s*$/.test(p));
+  });
+  if (accepts('br')) return 'br';
+  if (accepts('gzip')) return 'gzip';
+  return null;
+}
+
+export function sendJson(req: NextApiRequest, res: NextApiResponse, status: number, body: any): void {
+  const json = Buffer.from(JSON.stringify(body));
+  const encoding = json.length >= COMPRESS_MIN_BYTES ? acceptedEncoding(req) : null;
+
+  let payload = json;
+  if (encoding === 'br') {
+    payload = brotliCompressSync(json, {
+      params: {
+        [zlibConstants.BROTLI_PARAM_QUALITY]: BROTLI_QUALITY,
+        [zlibConstants.BROTLI_PARAM_MODE]: zlibConstants.BROTLI_MODE_TEXT,
+        [zlibConstants.BROTLI_PARAM_SIZE_HINT]: json.length
+      }
+    });
+  } else if (encoding === 'gzip') {
+    payload = gzipSync(json, { level: GZIP_LEVEL });
+  }
+
+  res.setHeader('Vary', 'Accept-Encoding');
+  res.setHeader('Content-Type', 'application/json; charset=utf-8');
+  if (encoding) res.setHeader('Content-Encoding', encoding);
+  res.setHeader('Content-Length', String(payload.length));
+  res.status(status).end(payload);
+}
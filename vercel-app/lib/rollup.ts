@@ -0,0 +1,407 @@
+// Multi-resolution history: per-bin min/max/avg rollups at 1 s, 1 min and 1 h
+//
+// Every sweep is folded into the open bucket of each resolution as it
+// arrives; raw sweeps are never kept. Each series (device + sweep plan) owns
+// fixed rings of buckets, whose size grows with its bin count; series are
+// evicted by total bytes (MAX_ROLLUP_BYTES), and a query only reads the
+// buckets inside its range. A background timer writes the buckets changed
+// since the last pass into ROLLUP_DIR in place; rings are reloaded on a
+// cold start.
+
+import { promises as fsp, readFileSync, readdirSync } from 'fs';
+import { tmpdir } from 'os';
+import { join } from 'path';
+
+export const ROLLUP_LEVELS = [
+  { name: '1s', resolutionMs: 1_000, slots: 900 },      // 15 min
+  { name: '1m', resolutionMs: 60_000, slots: 1_440 },   // 24 h
+  { name: '1h', resolutionMs: 3_600_000, slots: 720 }   // 30 days
+] as const;
+
+export type RollupResolution = typeof ROLLUP_LEVELS[number]['name'];
+
+// Least recently updated series dropped beyond this; a 64-bin series takes
+// about 1.6 MB, a 1024-bin one about 25 MB
+const MAX_ROLLUP_BYTES = (Number(process.env.ROLLUP_MAX_MB) || 64) * 1024 * 1024;
+const MAX_BINS = 1024;            // Matches the firmware's storage limit
+const MAX_QUERY_BUCKETS = 1_000;  // 'auto' picks the finest resolution under this
+const PERSIST_INTERVAL_MS = 60_000;
+const ROLLUP_DIR = process.env.ROLLUP_DIR ?? join(tmpdir(), 'spectrum-rollup');
+const FILE_VERSION = 2;
+const HEADER_BYTES = 1024;        // Fixed header area, so every slot sits at a fixed file offset
+
+// One resolution: slot i holds the bucket starting at starts[i]. Levels are
+// stored in 0.1 dB; sums in dBm so averages keep their precision.
+interface RollupLevel {
+  resolutionMs: number;
+  slots: number;
+  starts: Float64Array;  // Bucket start (ms epoch), 0 = empty slot
+  counts: Uint32Array;   // Sweeps folded into the bucket
+  min: Int16Array;       // slots x bins
+  max: Int16Array;
+  sum: Float32Array;
+  dirty: Uint8Array;     // Slots changed since they were last written
+}
+
+interface RollupSeries {
+  key: string;
+  deviceId: string;
+  freqBegin: number;
+  freqEnd: number;
+  freqSteps: number;
+  firstAt: number;
+  lastAt: number;
+  levels: RollupLevel[];
+  dirty: boolean;        // Any slot or the header changed
+  onDisk: boolean;       // The file exists with this series' full layout
+}
+
+export interface RollupBucket {
+  t: number;       // Bucket start (ms epoch, server clock)
+  sweeps: number;
+  min: number[];   // dBm per bin
+  max: number[];
+  avg: number[];
+}
+
+export interface RollupSeriesInfo {
+  deviceId: string;
+  freqBegin: number;
+  freqEnd: number;
+  freqSteps: number;
+  firstAt: number;
+  lastAt: number;
+}
+
+export interface RollupQueryResult extends RollupSeriesInfo {
+  resolution: RollupResolution;
+  from: number;
+  to: number;
+  buckets: RollupBucket[];
+}
+
+const series = new Map<string, RollupSeries>();
+let loaded = false;
+let persisting = false;
+
+function seriesKey(deviceId: string, freqBegin: number, freqEnd: number, freqSteps: number): string {
+  return `${deviceId}_${freqBegin}_${freqEnd}_${freqSteps}`.replace(/[^A-Za-z0-9_.-]/g, '-');
+}
+
+function newLevel(resolutionMs: number, slots: number, bins: number): RollupLevel {
+  return {
+    resolutionMs,
+    slots,
+    starts: new Float64Array(slots),
+    counts: new Uint32Array(slots),
+    min: new Int16Array(slots * bins),
+    max: new Int16Array(slots * bins),
+    sum: new Float32Array(slots * bins),
+    dirty: new Uint8Array(slots)
+  };
+}
+
+function levelBytes(slots: number, bins: number): number {
+  return slots * (8 + 4) + slots * bins * (2 + 2 + 4);  // starts, counts; min, max, sum
+}
+
+function seriesBytes(bins: number): number {
+  return ROLLUP_LEVELS.reduce((total, l) => total + levelBytes(l.slots, bins), 0);
+}
+
+// Fold one sweep, taken at `sweepTime` on the server clock, into every
+// resolution. `rssi` holds the sweep's values in bin order.
+export function recordRollup(
+  deviceId: string,
+  freqBegin: number,
+  freqEnd: number,
+  rssi: number[],
+  sweepTime: number
+): void {
+  const bins = rssi.length;
+  if (bins === 0 || bins > MAX_BINS || !Number.isFinite(sweepTime) || !rssi.every(Number.isFinite)) return;
+  ensureLoaded();
+
+  const key = seriesKey(deviceId, freqBegin, freqEnd, bins);
+  let s = series.get(key);
+  if (!s) {
+    s = {
+      key, deviceId, freqBegin, freqEnd, freqSteps: bins, firstAt: sweepTime, lastAt: sweepTime,
+      levels: ROLLUP_LEVELS.map(l => newLevel(l.resolutionMs, l.slots, bins)),
+      dirty: true,
+      onDisk: false
+    };
+    series.set(key, s);
+    evictSeries();
+  }
+
+  for (const level of s.levels) {
+    const start = Math.floor(sweepTime / level.resolutionMs) * level.resolutionMs;
+    const slot = Math.floor(start / level.resolutionMs) % level.slots;
+    if (start < level.starts[slot]) continue;  // Older than what the ring keeps
+    const base = slot * bins;
+    if (level.starts[slot] !== start) {
+      // Slot reused for a newer bucket
+      level.starts[slot] = start;
+      level.counts[slot] = 0;
+    }
+    const first = level.counts[slot] === 0;
+    for (let i = 0; i < bins; i++) {
+      const q = Math.max(-32768, Math.min(32767, Math.round(rssi[i] * 10)));
+      if (first || q < level.min[base + i]) level.min[base + i] = q;
+      if (first || q > level.max[base + i]) level.max[base + i] = q;
+      level.sum[base + i] = (first ? 0 : level.sum[base + i]) + rssi[i];
+    }
+    level.counts[slot]++;
+    level.dirty[slot] = 1;
+  }
+
+  s.firstAt = Math.min(s.firstAt, sweepTime);
+  s.lastAt = Math.max(s.lastAt, sweepTime);
+  s.dirty = true;
+}
+
+// The newest series always stays, even if it alone is over the budget
+function evictSeries() {
+  let total = 0;
+  series.forEach(s => { total += seriesBytes(s.freqSteps); });
+  while (total > MAX_ROLLUP_BYTES && series.size > 1) {
+    const oldest = Array.from(series.values()).reduce((a, b) => (b.lastAt < a.lastAt ? b : a));
+    series.delete(oldest.key);
+    total -= seriesBytes(oldest.freqSteps);
+    fsp.unlink(join(ROLLUP_DIR, `${oldest.key}.bin`)).catch(() => undefined);
+  }
+}
+
+export function listRollupSeries(): RollupSeriesInfo[] {
+  ensureLoaded();
+  return Array.from(series.values()).map(s => ({
+    deviceId: s.deviceId, freqBegin: s.freqBegin, freqEnd: s.freqEnd,
+    freqSteps: s.freqSteps, firstAt: s.firstAt, lastAt: s.lastAt
+  }));
+}
+
+// Finest resolution that still covers `from` and returns at most
+// MAX_QUERY_BUCKETS buckets; the coarsest one otherwise
+function pickResolution(from: number, to: number, now: number): RollupResolution {
+  for (const l of ROLLUP_LEVELS) {
+    const coversFrom = now - l.resolutionMs * l.slots <= from;
+    if (coversFrom && (to - from) / l.resolutionMs <= MAX_QUERY_BUCKETS) return l.name;
+  }
+  return ROLLUP_LEVELS[ROLLUP_LEVELS.length - 1].name;
+}
+
+// Buckets of one series between `from` and `to` (ms epoch). Without a device
+// the most recently updated series is used; a device with several sweep plans
+// answers with the one it used last.
+export function queryRollup(
+  from: number,
+  to: number,
+  resolution: RollupResolution | 'auto' = 'auto',
+  deviceId?: string,
+  now: number = Date.now()
+): RollupQueryResult | null {
+  ensureLoaded();
+  const candidates = Array.from(series.values()).filter(s => deviceId === undefined || s.deviceId === deviceId);
+  if (candidates.length === 0 || !(to >= from)) return null;
+  const s = candidates.reduce((a, b) => (b.lastAt > a.lastAt ? b : a));
+
+  const name = resolution === 'auto' ? pickResolution(from, to, now) : resolution;
+  const index = ROLLUP_LEVELS.findIndex(l => l.name === name);
+  const level = s.levels[index];
+  const bins = s.freqSteps;
+
+  // Walk only the bucket starts inside the range, at most one ring's worth
+  const buckets: RollupBucket[] = [];
+  const firstStart = Math.max(
+    Math.floor(from / level.resolutionMs),
+    Math.floor(to / level.resolutionMs) - level.slots + 1
+  ) * level.resolutionMs;
+  for (let start = firstStart; start <= to; start += level.resolutionMs) {
+    const slot = Math.floor(start / level.resolutionMs) % level.slots;
+    const count = level.counts[slot];
+    if (level.starts[slot] !== start || count === 0) continue;
+    const base = slot * bins;
+    const min = new Array<number>(bins);
+    const max = new Array<number>(bins);
+    const avg = new Array<number>(bins);
+    for (let i = 0; i < bins; i++) {
+      min[i] = level.min[base + i] / 10;
+      max[i] = level.max[base + i] / 10;
+      avg[i] = Math.round((level.sum[base + i] / count) * 10) / 10;
+    }
+    buckets.push({ t: start, sweeps: count, min, max, avg });
+  }
+
+  return {
+    deviceId: s.deviceId, freqBegin: s.freqBegin, freqEnd: s.freqEnd, freqSteps: bins,
+    firstAt: s.firstAt, lastAt: s.lastAt, resolution: name, from, to, buckets
+  };
+}
+
+// File per series: uint32 header length, JSON header padded to HEADER_BYTES,
+// then per level the starts, counts, min, max and sum arrays back to back.
+// Every slot has a fixed offset, so a persist pass writes only dirty slots.
+function encodeHeader(s: RollupSeries): Buffer | null {
+  const json = Buffer.from(JSON.stringify({
+    version: FILE_VERSION, key: s.key, deviceId: s.deviceId, freqBegin: s.freqBegin, freqEnd: s.freqEnd,
+    freqSteps: s.freqSteps, firstAt: s.firstAt, lastAt: s.lastAt,
+    levels: s.levels.map(l => ({ resolutionMs: l.resolutionMs, slots: l.slots }))
+  }));
+  if (json.length > HEADER_BYTES) return null;
+  const header = Buffer.alloc(4 + HEADER_BYTES, ' ');
+  header.writeUInt32LE(json.length, 0);
+  json.copy(header, 4);
+  return header;
+}
+
+interface SlotWrite {
+  position: number;
+  data: Buffer;
+}
+
+// Copies of the dirty slots (cleared as they are taken), with their file offsets
+function takeDirtySlots(s: RollupSeries): SlotWrite[] {
+  const bins = s.freqSteps;
+  const writes: SlotWrite[] = [];
+  const copy = (array: Float64Array | Uint32Array | Int16Array | Float32Array, from: number, count: number) =>
+    Buffer.from(array.slice(from, from + count).buffer);
+  let offset = 4 + HEADER_BYTES;
+  for (const l of s.levels) {
+    const startsAt = offset;
+    const countsAt = startsAt + l.slots * 8;
+    const minAt = countsAt + l.slots * 4;
+    const maxAt = minAt + l.slots * bins * 2;
+    const sumAt = maxAt + l.slots * bins * 2;
+    for (let slot = 0; slot < l.slots; slot++) {
+      if (!l.dirty[slot]) continue;
+      l.dirty[slot] = 0;
+      const base = slot * bins;
+      writes.push(
+        { position: minAt + base * 2, data: copy(l.min, base, bins) },
+        { position: maxAt + base * 2, data: copy(l.max, base, bins) },
+        { position: sumAt + base * 4, data: copy(l.sum, base, bins) },
+        // Start and count last: a slot cut short by a crash still reads as its old bucket or empty
+        { position: countsAt + slot * 4, data: copy(l.counts, slot, 1) },
+        { position: startsAt + slot * 8, data: copy(l.starts, slot, 1) }
+      );
+    }
+    offset += levelBytes(l.slots, bins);
+  }
+  return writes;
+}
+
+// After a failed write the whole series goes out again on the next pass
+function markAllDirty(s: RollupSeries) {
+  s.dirty = true;
+  s.onDisk = false;
+  for (const l of s.levels) {
+    for (let slot = 0; slot < l.slots; slot++) {
+      if (l.counts[slot] > 0) l.dirty[slot] = 1;
+    }
+  }
+}
+
+function decodeSeries(data: Buffer): RollupSeries | null {
+  const headerLength = data.readUInt32LE(0);
+  if (headerLength > HEADER_BYTES) return null;
+  const header = JSON.parse(data.toString('utf8', 4, 4 + headerLength));
+  if (header.version !== FILE_VERSION) return null;
+
+  const bins: number = header.freqSteps;
+  let offset = 4 + HEADER_BYTES;
+  // Copy each array out, since typed arrays need aligned offsets
+  const take = <T>(bytes: number, make: (buffer: ArrayBuffer) => T): T => {
+    const copy = new Uint8Array(bytes);
+    copy.set(data.subarray(offset, offset + bytes));
+    offset += bytes;
+    return make(copy.buffer);
+  };
+
+  const levels: RollupLevel[] = [];
+  for (const l of header.levels) {
+    const expected = ROLLUP_LEVELS[levels.length];
+    if (!expected || expected.resolutionMs !== l.resolutionMs || expected.slots !== l.slots) return null;
+    levels.push({
+      resolutionMs: l.resolutionMs,
+      slots: l.slots,
+      starts: take(l.slots * 8, b => new Float64Array(b)),
+      counts: take(l.slots * 4, b => new Uint32Array(b)),
+      min: take(l.slots * bins * 2, b => new Int16Array(b)),
+      max: take(l.slots * bins * 2, b => new Int16Array(b)),
+      sum: take(l.slots * bins * 4, b => new Float32Array(b)),
+      dirty: new Uint8Array(l.slots)
+    });
+  }
+  if (offset !== data.length || levels.length !== ROLLUP_LEVELS.length) return null;
+  return {
+    key: header.key, deviceId: header.deviceId, freqBegin: header.freqBegin, freqEnd: header.freqEnd,
+    freqSteps: bins, firstAt: header.firstAt, lastAt: header.lastAt, levels, dirty: false, onDisk: true
+  };
+}
+
+// Runs from a timer, never inside a request. Only the slots changed since
+// the last pass are copied (a few KB per second-bucket) and written at their
+// offsets; a new series' file is created at full size first, so its empty
+// slots need no writing at all.
+export function persistRollups(): void {
+  if (persisting) return;
+  const jobs: { s: RollupSeries; create: boolean; header: Buffer; writes: SlotWrite[] }[] = [];
+  series.forEach(s => {
+    if (!s.dirty) return;
+    const header = encodeHeader(s);
+    if (!header) return;  // Device id too long to store; kept in memory only
+    s.dirty = false;
+    jobs.push({ s, create: !s.onDisk, header, writes: takeDirtySlots(s) });
+    s.onDisk = true;
+  });
+  if (jobs.length === 0) return;
+
+  persisting = true;
+  (async () => {
+    await fsp.mkdir(ROLLUP_DIR, { recursive: true });
+    for (const { s, create, header, writes } of jobs) {
+      const file = join(ROLLUP_DIR, `${s.key}.bin`);
+      try {
+        const handle = await fsp.open(file, create ? 'w' : 'r+');
+        try {
+          if (create) await handle.truncate(4 + HEADER_BYTES + seriesBytes(s.freqSteps));
+          for (const { position, data } of writes) {
+            await handle.write(data, 0, data.length, position);
+          }
+          await handle.write(header, 0, header.length, 0);
+        } finally {
+          await handle.close();
+        }
+        if (series.get(s.key) !== s) await fsp.unlink(file).catch(() => undefined);  // Evicted meanwhile
+      } catch (error) {
+        console.error(`Rollup persist failed for ${s.key}:`, error);
+        markAllDirty(s);
+      }
+    }
+  })().finally(() => {
+    persisting = false;
+  });
+}
+
+function ensureLoaded() {
+  if (loaded) return;
+  loaded = true;
+  const timer: { unref?: () => void } = setInterval(persistRollups, PERSIST_INTERVAL_MS) as any;
+  if (timer.unref) timer.unref();  // Never keeps the process alive on its own
+  let files: string[];
+  try {
+    files = readdirSync(ROLLUP_DIR).filter(f => f.endsWith('.bin'));
+  } catch {
+    return;  // Nothing stored yet
+  }
+  for (const file of files) {
+    try {
+      const s = decodeSeries(readFileSync(join(ROLLUP_DIR, file)));
+      if (s && s.key) series.set(s.key, s);
+    } catch (error) {
+      console.error(`Skipping unreadable rollup ${file}:`, error);
+    }
+  }
+  evictSeries();
+}
@@ -0,0 +1,57 @@
+// API endpoint for spectrum history, answered from the rollups only
+import type { NextApiRequest, NextApiResponse } from 'next';
+import { listRollupSeries, queryRollup, ROLLUP_LEVELS, RollupResolution } from '../../lib/rollup';
+import { sendJson } from '../../lib/respond';
+
+const DEFAULT_RANGE_MS = 3_600_000;  // Last hour when no range is given
+
+function queryNumber(value: string | string[] | undefined): number | undefined {
+  const n = Number(Array.isArray(value) ? value[0] : value);
+  return value !== undefined && Number.isFinite(n) ? n : undefined;
+}
+
+export default function handler(req: NextApiRequest, res: NextApiResponse) {
+  res.setHeader('Access-Control-Allow-Origin', '*');
+  res.setHeader('Access-Control-Allow-Methods', 'GET, OPTIONS');
+  res.setHeader('Access-Control-Allow-Headers', 'Content-Type');
+
+  if (req.method === 'OPTIONS') {
+    res.status(200).end();
+    return;
+  }
+  if (req.method !== 'GET') {
+    res.status(405).json({ error: 'Method not allowed' });
+    return;
+  }
+
+  //   ?series                     stored devices/plans and their time spans
+  //   ?from=&to=                  ms epoch, default the last hour
+  //   ?resolution=1s|1m|1h|auto   bucket size, auto keeps the answer small
+  //   ?device=<id>                default: the most recently updated device
+  if (req.query.series !== undefined) {
+    res.status(200).json({ series: listRollupSeries() });
+    return;
+  }
+
+  const now = Date.now();
+  const to = queryNumber(req.query.to) ?? now;
+  const from = queryNumber(req.query.from) ?? to - DEFAULT_RANGE_MS;
+  const resolution = typeof req.query.resolution === 'string' ? req.query.resolution : 'auto';
+  if (resolution !== 'auto' && !ROLLUP_LEVELS.some(l => l.name === resolution)) {
+    res.status(400).json({ error: `resolution must be auto or one of ${ROLLUP_LEVELS.map(l => l.name).join(', ')}` });
+    return;
+  }
+  if (!(to >= from)) {
+    res.status(400).json({ error: 'from must not be after to' });
+    return;
+  }
+
+  const device = typeof req.query.device === 'string' ? req.query.device : undefined;
+  const body = queryRollup(from, to, resolution as RollupResolution | 'auto', device, now);
+  if (body) {
+    // Hundreds of buckets of per-bin arrays; compressed like the live views
+    sendJson(req, res, 200, body);
+  } else {
+    res.status(404).json({ error: 'No history available' });
+  }
+}
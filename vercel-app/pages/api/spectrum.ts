@@ -1,8 +1,21 @@
 // API endpoint to receive spectrum data from ESP32
 import type { NextApiRequest, NextApiResponse } from 'next';
+import {
+  ingestSweep,
+  BOOT_ID,
+  getIngestSeq,
+  getLatestSweep,
+  getDeviceSummaries,
+  getMergedView,
+  getOverlayView
+} from '../../lib/aggregator';
+import { toColumnar } from '../../lib/columnar';
+import { notModified, sendJson } from '../../lib/respond';
 
-// In-memory storage (for demo - use database in production)
-let latestSpectrumData: any = null;
+function queryNumber(value: string | string[] | undefined): number | undefined {
+  const n = Number(Array.isArray(value) ? value[0] : value);
+  return value !== undefined && Number.isFinite(n) ? n : undefined;
+}
 
 export default async function handler(
   req: NextApiRequest,
@@ -11,7 +24,8 @@ export default async function handler(
   // Enable CORS
   res.setHeader('Access-Control-Allow-Origin', '*');
   res.setHeader('Access-Control-Allow-Methods', 'GET, POST, OPTIONS');
-  res.setHeader('Access-Control-Allow-Headers', 'Content-Type');
+  res.setHeader('Access-Control-Allow-Headers', 'Content-Type, If-None-Match');
+  res.setHeader('Access-Control-Expose-Headers', 'ETag');
 
   if (req.method === 'OPTIONS') {
     res.status(200).end();
@@ -21,16 +35,12 @@ export default async function handler(
   if (req.method === 'POST') {
     // Receive data from ESP32
     try {
-      const data = req.body;
-      latestSpectrumData = {
-        ...data,
-        receivedAt: new Date().toISOString()
-      };
+      const data = ingestSweep(req.body);
       
       console.log('Received spectrum data:', {
         deviceId: data.deviceId,
         timestamp: data.timestamp,
-        dataPoints: data.data?.length
+        dataPoints: data.data.length
       });
       
       res.status(200).json({ success: true, message: 'Data received' });
@@ -40,13 +50,47 @@ export default async function handler(
     }
   } else if (req.method === 'GET') {
     // Send latest data to web page
-    if (latestSpectrumData) {
-      res.status(200).json(latestSpectrumData);
+    //   ?view=merged   max across nodes, aligned by sweep time
+    //   ?view=overlay  every node's value per frequency
+    //   ?view=devices  per-device last-seen and sweep rate
+    //   ?device=<id>   latest sweep of one node
+    // `at` (ms epoch) and `tolerance` (ms) control the alignment.
+    //   ?format=columnar  one array per field instead of a point object per bin
+    // Responses carry an ETag; a matching If-None-Match gets 304 and no body.
+    const view = req.query.view;
+    const at = queryNumber(req.query.at);
+    const tolerance = queryNumber(req.query.tolerance);
+    const columnar = req.query.format === 'columnar';
+    const device = typeof req.query.device === 'string' ? req.query.device : undefined;
+
+    const version = view === undefined && device !== undefined ? getIngestSeq(device) : getIngestSeq();
+    const etag = `W/"${BOOT_ID}.${version}${columnar ? 'c' : ''}"`;
+    if (notModified(req, res, etag)) return;
+
+    let body: any;
+    if (view === 'merged') {
+      body = getMergedView(at, tolerance);
+    } else if (view === 'overlay') {
+      body = getOverlayView(at, tolerance);
+    } else if (view === 'devices') {
+      body = { devices: getDeviceSummaries() };
+    } else if (device !== undefined) {
+      body = getLatestSweep(device);
     } else {
+      body = getLatestSweep();
+    }
+
+    if (body) {
+      // Stamp the hand-off so the page can split poll wait from transfer time
+      if (body.trace) {
+        body = { ...body, trace: { ...body.trace, servedAt: Date.now() } };
+      }
+      sendJson(req, res, 200, columnar ? toColumnar(body) : body);
+    } else {
+      res.removeHeader('ETag');
       res.status(404).json({ error: 'No data available' });
     }
   } else {
     res.status(405).json({ error: 'Method not allowed' });
   }
 }
-
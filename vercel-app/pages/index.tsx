@@ -1,10 +1,23 @@
 // Real-time Spectrum Analyzer Web Page
-import { useEffect, useState } from 'react';
+import { useEffect, useRef, useState } from 'react';
 import { LineChart, Line, XAxis, YAxis, CartesianGrid, Tooltip, Legend, ResponsiveContainer } from 'recharts';
+import type { SweepTrace } from '../lib/aggregator';
+import { fromColumnar } from '../lib/columnar';
+import { LATENCY_STAGES, LatencySample, latencyBreakdown, percentile } from '../lib/latency';
+
+const LATENCY_WINDOW = 200;  // Sweeps kept for latency percentiles
 
 interface SpectrumDataPoint {
   freq: number;
   rssi: number;
+  deviceId?: string;  // Contributing node in the merged view
+}
+
+interface DeviceSummary {
+  deviceId: string;
+  lastSeen: number;  // Server ms epoch
+  ratePerSec: number;
+  sweeps: number;
 }
 
 interface SpectrumData {
@@ -15,20 +28,56 @@ interface SpectrumData {
   freqSteps: number;
   data: SpectrumDataPoint[];
   receivedAt: string;
+  aligned?: { deviceId: string; skewMs: number }[];
+  devices?: DeviceSummary[];
+  seq?: number;
+  sweepStart?: number;
+  sweepEnd?: number;
+  trace?: SweepTrace;
+}
+
+interface PendingTrace {
+  sweep: SpectrumData;
+  fetchStart: number;
+  fetchEnd: number;
 }
 
 export default function Home() {
   const [spectrumData, setSpectrumData] = useState<SpectrumData | null>(null);
   const [isConnected, setIsConnected] = useState(false);
   const [lastUpdate, setLastUpdate] = useState<Date | null>(null);
+  const [latencySamples, setLatencySamples] = useState<LatencySample[]>([]);
+  const pendingTrace = useRef<PendingTrace | null>(null);
+  const lastTracedSweep = useRef<number | null>(null);
+  const etag = useRef<string | null>(null);
+  const serverOffset = useRef(0);  // Server clock minus ours, from the last served sweep
+  const [clock, setClock] = useState(Date.now());
 
   useEffect(() => {
     // Poll for new data every 250ms for snappier updates
     const interval = setInterval(async () => {
       try {
-        const response = await fetch('/api/spectrum');
-        if (response.ok) {
-          const data = await response.json();
+        // Merged view: max across all nodes, aligned by sweep time
+        // Conditional and columnar: polls between sweeps come back as an empty 304
+        const fetchStart = performance.now();
+        const response = await fetch('/api/spectrum?view=merged&format=columnar', {
+          cache: 'no-store',
+          headers: etag.current ? { 'If-None-Match': etag.current } : {}
+        });
+        if (response.status === 304) {
+          setIsConnected(true);
+        } else if (response.ok) {
+          etag.current = response.headers.get('ETag');
+          const data: SpectrumData = fromColumnar(await response.json());
+          if (data.trace?.servedAt !== undefined) {
+            serverOffset.current = data.trace.servedAt - Date.now();
+          }
+          // Trace each sweep once, on the poll that first delivers it
+          const sweepKey = data.trace?.serverRxAt ?? null;
+          if (sweepKey !== null && sweepKey !== lastTracedSweep.current) {
+            lastTracedSweep.current = sweepKey;
+            pendingTrace.current = { sweep: data, fetchStart, fetchEnd: performance.now() };
+          }
           setSpectrumData(data);
           setIsConnected(true);
           setLastUpdate(new Date());
@@ -44,6 +93,30 @@ export default function Home() {
     return () => clearInterval(interval);
   }, []);
 
+  // Node ages are computed here, so they keep counting while polls return 304
+  useEffect(() => {
+    const interval = setInterval(() => setClock(Date.now()), 1000);
+    return () => clearInterval(interval);
+  }, []);
+
+  // Close the trace once the new sweep has actually been painted
+  useEffect(() => {
+    const pending = pendingTrace.current;
+    if (!pending || pending.sweep !== spectrumData) return;
+    pendingTrace.current = null;
+    requestAnimationFrame(() => requestAnimationFrame(() => {
+      const sample = latencyBreakdown(pending.sweep, pending.fetchStart, pending.fetchEnd, performance.now());
+      setLatencySamples(samples => [...samples.slice(-(LATENCY_WINDOW - 1)), sample]);
+    }));
+  }, [spectrumData]);
+
+  const latencyRows = [...LATENCY_STAGES, 'total' as const]
+    .map(stage => ({
+      stage,
+      values: latencySamples.map(s => s[stage]).filter((v): v is number => v !== undefined)
+    }))
+    .filter(row => row.values.length > 0);
+
   // Prepare data for chart
   const chartData = spectrumData?.data?.map(point => ({
     frequency: point.freq.toFixed(1),
@@ -85,12 +158,39 @@ export default function Home() {
           border: '1px solid #b3d9ff',
           borderRadius: '5px'
         }}>
-          <strong>Device ID:</strong> {spectrumData.deviceId}<br />
+          <strong>Device ID:</strong> {spectrumData.aligned && spectrumData.aligned.length > 1
+            ? `max of ${spectrumData.aligned.length} nodes`
+            : spectrumData.aligned?.[0]?.deviceId ?? spectrumData.deviceId}<br />
           <strong>Frequency Range:</strong> {spectrumData.freqBegin} - {spectrumData.freqEnd} MHz<br />
           <strong>Resolution:</strong> {spectrumData.freqSteps} steps
         </div>
       )}
 
+      {/* Nodes */}
+      {spectrumData?.devices && spectrumData.devices.length > 1 && (
+        <div style={{ 
+          padding: '10px', 
+          marginBottom: '20px', 
+          backgroundColor: '#f7f7f7',
+          border: '1px solid #ddd',
+          borderRadius: '5px'
+        }}>
+          <strong>Nodes</strong>
+          <table style={{ marginTop: '6px', fontSize: '14px' }}>
+            <tbody>
+              {spectrumData.devices.map(device => (
+                <tr key={device.deviceId}>
+                  <td style={{ paddingRight: '16px' }}>{device.deviceId}</td>
+                  <td style={{ paddingRight: '16px' }}>seen {(Math.max(0, clock + serverOffset.current - device.lastSeen) / 1000).toFixed(1)} s ago</td>
+                  <td style={{ paddingRight: '16px' }}>{device.ratePerSec.toFixed(2)} sweeps/s</td>
+                  <td>{spectrumData.aligned?.some(a => a.deviceId === device.deviceId) ? 'in view' : 'not aligned'}</td>
+                </tr>
+              ))}
+            </tbody>
+          </table>
+        </div>
+      )}
+
       {/* Spectrum Chart */}
       <div style={{ 
         backgroundColor: 'white', 
@@ -147,12 +247,42 @@ export default function Home() {
                 }}>
                   <strong>{point.freq.toFixed(1)} MHz</strong><br />
                   RSSI: {point.rssi.toFixed(1)} dBm
+                  {spectrumData.devices && spectrumData.devices.length > 1 && point.deviceId && (
+                    <><br />Node: {point.deviceId}</>
+                  )}
                 </div>
               ))}
           </div>
         </div>
       )}
 
+      {/* Latency breakdown */}
+      {latencyRows.length > 0 && (
+        <div style={{ marginTop: '20px' }}>
+          <h3>Latency (last {latencySamples.length} sweeps, ms)</h3>
+          <table style={{ borderCollapse: 'collapse', fontSize: '14px' }}>
+            <thead>
+              <tr>
+                {['Stage', 'Last', 'p50', 'p95', 'p99'].map(h => (
+                  <th key={h} style={{ textAlign: 'left', padding: '4px 12px', borderBottom: '1px solid #ddd' }}>{h}</th>
+                ))}
+              </tr>
+            </thead>
+            <tbody>
+              {latencyRows.map(row => (
+                <tr key={row.stage} style={{ fontWeight: row.stage === 'total' ? 'bold' : 'normal' }}>
+                  <td style={{ padding: '4px 12px' }}>{row.stage}</td>
+                  <td style={{ padding: '4px 12px' }}>{row.values[row.values.length - 1].toFixed(0)}</td>
+                  <td style={{ padding: '4px 12px' }}>{percentile(row.values, 50).toFixed(0)}</td>
+                  <td style={{ padding: '4px 12px' }}>{percentile(row.values, 95).toFixed(0)}</td>
+                  <td style={{ padding: '4px 12px' }}>{percentile(row.values, 99).toFixed(0)}</td>
+                </tr>
+              ))}
+            </tbody>
+          </table>
+        </div>
+      )}
+
       {/* Instructions */}
       {!isConnected && (
         <div style={{